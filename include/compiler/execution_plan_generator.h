@@ -18,6 +18,7 @@ struct PlanNode {
         UPDATE,
         DELETE,
         DROP_TABLE,
+        VACUUM,
         // 新增三种逻辑算子
         SEQ_SCAN,
         FILTER,
@@ -182,6 +183,20 @@ struct DropTablePlanNode : public PlanNode {
     }
 };
 
+// VACUUM 语句的执行计划节点（tableName 为空表示所有用户表）
+struct VacuumPlanNode : public PlanNode {
+    std::string tableName;
+    explicit VacuumPlanNode(const std::string& table) : tableName(table) {
+        type = PlanNodeType::VACUUM;
+    }
+    std::string to_json() const override {
+        std::ostringstream os; os << "{\"type\":\"Vacuum\",\"table\":\"" << tableName << "\"}"; return os.str();
+    }
+    std::string to_sexpr() const override {
+        std::ostringstream os; os << "(Vacuum" << (tableName.empty() ? "" : " " + tableName) << ")"; return os.str();
+    }
+};
+
 // 新增：顺序扫描
 struct SeqScanPlanNode : public PlanNode {
     std::string tableName;
@@ -31,6 +31,7 @@ private:
     void visit(DeleteStatement* node);
     void visit(UpdateStatement* node);
     void visit(DropTableStatement* node);
+    void visit(VacuumStatement* node);
 
     // 新增：访问 CREATE INDEX 语句
     void visit(CreateIndexStatement* node);
@@ -80,6 +80,12 @@ struct DropTableStatement : public ASTNode {
     size_t tableTokenIndex;
 };
 
+// VACUUM 语句节点（tableName 为空表示所有用户表）
+struct VacuumStatement : public ASTNode {
+    std::string tableName;
+    size_t tableTokenIndex{0};
+};
+
 // WHERE 子句节点
 struct WhereClause : public ASTNode {
     std::string condition;
@@ -121,6 +127,8 @@ private:
 
     // 新增：处理 DROP TABLE 语句
     std::unique_ptr<ASTNode> parseDropTableStatement();
+    // VACUUM [table]
+    std::unique_ptr<ASTNode> parseVacuumStatement();
 
     // 子句解析函数
     std::vector<std::string> parseSelectList();
@@ -23,6 +23,7 @@ public:
     void visit(CreateIndexStatement* node, const std::vector<Token>& tokens);
     // 新增：DROP TABLE 语义分析
     void visit(DropTableStatement* node, const std::vector<Token>& tokens);
+    void visit(VacuumStatement* node, const std::vector<Token>& tokens);
 
 private:
     void reportError(const std::string& message, size_t tokenIndex, const std::vector<Token>& tokens);
@@ -51,7 +52,6 @@ private:
 
     // 简单 WHERE 谓词解析与评估（为 UPDATE 唯一性检查准备）
     static bool parse_simple_condition(const std::string& cond, std::string& col, std::string& op, std::string& val);
-    static bool compare_typed(DataType type, const std::string& left, const std::string& op, const std::string& right);
 
 private:
     pcsql::StorageEngine* storage_ {nullptr};
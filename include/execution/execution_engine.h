@@ -23,7 +23,7 @@ public:
     // 接收编译结果执行
     std::string execute(const Compiler::CompiledUnit& unit);
 
-    // 新增：直接返回 SELECT 的原始行（record-string，使用 '|' 分隔字段）供服务器封包
+    // 新增：直接返回 SELECT 的原始行（存储格式：二进制元组，用 pcsql::TupleView 按表结构读取）供服务器封包
     std::vector<std::pair<pcsql::RID, std::string>> selectRows(SelectStatement* stmt);
 
 private:
@@ -36,9 +36,13 @@ private:
     std::string handleUpdate(UpdateStatement* stmt);
     // 新增：DROP TABLE
     std::string handleDropTable(DropTableStatement* stmt);
+    // VACUUM [table]：压缩堆页、回收空页
+    std::string handleVacuum(VacuumStatement* stmt);
 
     // 便捷：把表按行扫描转为二维文本
-    static std::string format_rows(const std::vector<std::pair<pcsql::RID, std::string>>& rows);
+    static std::string format_rows(const std::vector<std::pair<pcsql::RID, std::string>>& rows,
+                                   const pcsql::TupleLayout& layout,
+                                   const pcsql::OverflowStore* overflow);
 
     // 复用：构建 SELECT 结果行，并可选输出调试信息（索引范围等）。
     bool buildSelectRows(SelectStatement* stmt,
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace pcsql {
+
+// Heap buffer aligned to ALIGNMENT bytes and zero-filled. Used for the buffer pool
+// arena and for bounce buffers, so page I/O also works when data.db is opened with O_DIRECT.
+class AlignedBuffer {
+public:
+    static constexpr std::size_t ALIGNMENT = 4096;
+
+    AlignedBuffer() = default;
+    explicit AlignedBuffer(std::size_t size) { reset(size); }
+    ~AlignedBuffer() { std::free(ptr_); }
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+    AlignedBuffer(AlignedBuffer&& o) noexcept
+        : ptr_(std::exchange(o.ptr_, nullptr)), size_(std::exchange(o.size_, 0)) {}
+    AlignedBuffer& operator=(AlignedBuffer&& o) noexcept {
+        if (this != &o) {
+            std::free(ptr_);
+            ptr_ = std::exchange(o.ptr_, nullptr);
+            size_ = std::exchange(o.size_, 0);
+        }
+        return *this;
+    }
+
+    void reset(std::size_t size) {
+        std::free(ptr_);
+        ptr_ = nullptr;
+        size_ = size;
+        if (size == 0) return;
+        // aligned_alloc requires the size to be a multiple of the alignment
+        std::size_t rounded = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        ptr_ = static_cast<char*>(std::aligned_alloc(ALIGNMENT, rounded));
+        if (!ptr_) throw std::bad_alloc();
+        std::memset(ptr_, 0, rounded);
+    }
+
+    char* data() { return ptr_; }
+    const char* data() const { return ptr_; }
+    std::size_t size() const { return size_; }
+
+    static bool is_aligned(const void* p) {
+        return reinterpret_cast<std::uintptr_t>(p) % ALIGNMENT == 0;
+    }
+
+private:
+    char* ptr_{nullptr};
+    std::size_t size_{0};
+};
+
+} // namespace pcsql
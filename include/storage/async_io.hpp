@@ -0,0 +1,66 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace pcsql {
+
+// One page-sized read or write against the data file
+struct IoRequest {
+    enum class Op : std::uint8_t { Read, Write };
+    Op op{Op::Read};
+    std::uint32_t page_id{0};
+    void* buffer{nullptr};
+    int result{0}; // 0 on success, -errno on failure (filled on completion)
+};
+
+enum class IoBackend {
+    Auto,       // io_uring when the kernel allows it, else thread pool
+    ThreadPool,
+    IoUring
+};
+
+// Completion handle for a submitted batch. The requests (and the buffers they
+// point to) must stay alive until wait() returns.
+class IoBatch {
+public:
+    explicit IoBatch(std::vector<IoRequest> reqs)
+        : requests_(std::move(reqs)), remaining_(requests_.size()) {}
+
+    // Block until every request completed; throws std::runtime_error on the first failed request
+    void wait();
+    bool done() const;
+
+    std::vector<IoRequest>& requests() { return requests_; }
+    const std::vector<IoRequest>& requests() const { return requests_; }
+
+    // Called by engines when request i finished
+    void complete(std::size_t i, int result);
+
+private:
+    std::vector<IoRequest> requests_;
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::size_t remaining_;
+};
+
+// Asynchronous page I/O over one file descriptor. submit() returns immediately;
+// the batch completes on worker threads (thread pool) or on the kernel ring (io_uring).
+class AsyncIoEngine {
+public:
+    virtual ~AsyncIoEngine() = default;
+
+    virtual std::shared_ptr<IoBatch> submit(std::vector<IoRequest> reqs) = 0;
+    virtual const char* name() const = 0;
+
+    // Pick a backend. Auto falls back to the thread pool if io_uring setup fails
+    // (old kernel, seccomp, RLIMIT_MEMLOCK, ...).
+    static std::unique_ptr<AsyncIoEngine> create(int fd, std::size_t page_size,
+                                                 IoBackend backend = IoBackend::Auto,
+                                                 std::size_t threads = 4);
+};
+
+} // namespace pcsql
@@ -11,6 +11,7 @@
 
 #include "storage/buffer_manager.hpp"
 #include "storage/disk_manager.hpp"
+#include "storage/page_guard.hpp"
 #include "storage/record_manager.hpp" // for RID
 
 namespace pcsql {
@@ -50,6 +51,8 @@ public:
 
     // Enable/disable verbose tracing for educational/demo purposes
     void set_trace(bool on) { trace_ = on; }
+    // Table the index belongs to (buffer pool statistics attribute its pages to that table)
+    void set_owner(std::int32_t table_id) { owner_ = table_id; }
 
     // Create a new empty B+Tree and return the root page id (persist this in your catalog)
     std::uint32_t create();
@@ -69,6 +72,8 @@ public:
     std::vector<std::pair<Key, RID>> range(const Key& low, const Key& high) const;
 
     // Erase by key (unique). Returns false if key not exists.
+    // Entries are only removed from the leaf (no merge/redistribution): leaves may become
+    // empty while separators stay valid, so search, insert and range keep working.
     bool erase(const Key& key);
 
 private:
@@ -97,8 +102,9 @@ private:
     static constexpr std::size_t HEADER_SZ = sizeof(NodeHdr);
     static constexpr std::size_t LEAF_ENTRY_SZ = sizeof(LeafEntry);
     static constexpr std::size_t INTER_ENTRY_SZ = sizeof(InterEntry);
-    static constexpr std::size_t LEAF_CAP() { return (PAGE_SIZE - HEADER_SZ) / LEAF_ENTRY_SZ; }
-    static constexpr std::size_t INTER_CAP() { return (PAGE_SIZE - HEADER_SZ) / INTER_ENTRY_SZ; }
+    // Node capacities follow the database page size (fixed once data.db is formatted)
+    std::size_t LEAF_CAP() const { return (buffer_.page_size() - HEADER_SZ) / LEAF_ENTRY_SZ; }
+    std::size_t INTER_CAP() const { return (buffer_.page_size() - HEADER_SZ) / INTER_ENTRY_SZ; }
 
     static NodeHdr& hdr(Page& p) { return *reinterpret_cast<NodeHdr*>(p.data.data()); }
     static const NodeHdr& hdr(const Page& p) { return *reinterpret_cast<const NodeHdr*>(p.data.data()); }
@@ -110,13 +116,25 @@ private:
     static const InterEntry* inter_entries(const Page& p) { return reinterpret_cast<const InterEntry*>(p.data.data() + HEADER_SZ); }
 
     // helpers
+    // New node page, tagged for the buffer pool statistics
+    std::uint32_t allocate_node(bool leaf) {
+        std::uint32_t pid = disk_.allocate_page();
+        buffer_.tag_page(pid, leaf ? PageKind::IndexLeaf : PageKind::IndexInternal, owner_);
+        return pid;
+    }
+    // Tags are kept in memory only: nodes of an existing tree are tagged as descents reach them
+    void note_kind(std::uint32_t pid, const Page& p) const {
+        if (p.kind.load(std::memory_order_relaxed) != PageKind::Unknown) return;
+        buffer_.tag_page(pid, hdr(p).is_leaf ? PageKind::IndexLeaf : PageKind::IndexInternal, owner_);
+    }
     std::uint32_t find_leaf(const Key& key) const;
     bool insert_in_leaf(Page& leaf, std::uint32_t leaf_id, const Key& key, const RID& rid);
-    void split_leaf_and_insert(Page& leaf, std::uint32_t leaf_id, const Key& key, const RID& rid);
+    // The split helpers release the guard they are given before recursing into insert_in_parent
+    void split_leaf_and_insert(WritePageGuard& leaf, const Key& key, const RID& rid);
 
-    void insert_in_parent(std::uint32_t left_id, const Key& key, std::uint32_t right_id);
+    void insert_in_parent(std::uint32_t left_id, std::uint32_t parent_id, const Key& key, std::uint32_t right_id);
     bool insert_in_internal(Page& page, std::uint32_t pid, const Key& key, std::uint32_t right_id);
-    void split_internal_and_insert(Page& page, std::uint32_t pid, const Key& key, std::uint32_t right_id);
+    void split_internal_and_insert(WritePageGuard& page, const Key& key, std::uint32_t right_id);
 
     int leaf_lower_bound(const Page& leaf, const Key& key) const;
     int inter_child_index(const Page& inter, const Key& key) const;
@@ -133,18 +151,20 @@ private:
     std::uint32_t root_{std::numeric_limits<std::uint32_t>::max()};
     Comparator comp_{};
     bool trace_{false};
+    std::int32_t owner_{-1};
 };
 
 // ============ implementation ============
 
 template <typename Key, typename Comparator>
 std::uint32_t BPlusTreeT<Key, Comparator>::create() {//创建B+树
-    std::uint32_t root = disk_.allocate_page();//磁盘分配页，返回页id，->root
-    Page& p = buffer_.get_page(root);//向buffer索要root页
-    auto& h = hdr(p);
-    h.is_leaf = 1; h.reserved = 0; h.count = 0; h.parent = std::numeric_limits<std::uint32_t>::max();
-    h.next = std::numeric_limits<std::uint32_t>::max(); h.leftmost = std::numeric_limits<std::uint32_t>::max();
-    buffer_.unpin_page(root, true);//脏页写回
+    std::uint32_t root = allocate_node(true);//磁盘分配页，返回页id，->root
+    {
+        WritePageGuard g(buffer_, root);//向buffer索要root页（析构时置脏写回）
+        auto& h = hdr(g.page());
+        h.is_leaf = 1; h.reserved = 0; h.count = 0; h.parent = std::numeric_limits<std::uint32_t>::max();
+        h.next = std::numeric_limits<std::uint32_t>::max(); h.leftmost = std::numeric_limits<std::uint32_t>::max();
+    }
     root_ = root;//全局变量root_为根索引
     if (trace_) {
         std::cout << "[B+Tree] create new tree with root page " << root_ << "\n";
@@ -154,19 +174,20 @@ std::uint32_t BPlusTreeT<Key, Comparator>::create() {//创建B+树
 
 template <typename Key, typename Comparator>
 std::uint32_t BPlusTreeT<Key, Comparator>::find_leaf(const Key& key) const {
-    //找到key所在的子叶
+    //找到key所在的子叶；下降时闩锁耦合：先锁住孩子再释放父节点
     std::uint32_t pid = root_;
     if (trace_) {
         std::cout << "[B+Tree] find_leaf(" << key << ") start at root " << pid << "\n";
     }
+    ReadPageGuard cur(buffer_, pid);
     while (true) {
-        Page& p = const_cast<BufferManager&>(buffer_).get_page(pid);
+        const Page& p = cur.page();
         const auto& h = hdr(p);
+        note_kind(pid, p);
         if (h.is_leaf) {
             if (trace_) {
                 std::cout << "[B+Tree] reached leaf page " << pid << " (count=" << h.count << ")\n";
             }
-            const_cast<BufferManager&>(buffer_).unpin_page(pid, false);
             return pid;
         }
         int idx = inter_child_index(p, key);
@@ -182,7 +203,8 @@ std::uint32_t BPlusTreeT<Key, Comparator>::find_leaf(const Key& key) const {
                 std::cout << "[B+Tree] internal page " << pid << ": descend to child at idx=" << idx << " -> " << child << "\n";
             }
         }
-        const_cast<BufferManager&>(buffer_).unpin_page(pid, false);
+        ReadPageGuard next(buffer_, child);
+        cur = std::move(next);//释放父节点
         pid = child;
     }
 }
@@ -216,7 +238,8 @@ template <typename Key, typename Comparator>
 bool BPlusTreeT<Key, Comparator>::search(const Key& key, RID& out) const {
     if (root_ == std::numeric_limits<std::uint32_t>::max()) return false;
     std::uint32_t leaf_id = find_leaf(key);
-    Page& p = const_cast<BufferManager&>(buffer_).get_page(leaf_id);
+    ReadPageGuard guard(buffer_, leaf_id);
+    const Page& p = guard.page();
     const auto& h = hdr(p);
     int i = leaf_lower_bound(p, key);
     bool ok = (i < h.count) && eq(leaf_entries(p)[i].key, key);
@@ -231,7 +254,6 @@ bool BPlusTreeT<Key, Comparator>::search(const Key& key, RID& out) const {
     } else if (trace_) {
         std::cout << "[B+Tree] search(" << key << ") not found in leaf " << leaf_id << "\n";
     }
-    const_cast<BufferManager&>(buffer_).unpin_page(leaf_id, false);
     return ok;
 }
 
@@ -241,7 +263,8 @@ std::vector<std::pair<Key, RID>> BPlusTreeT<Key, Comparator>::range(const Key& l
     if (root_ == std::numeric_limits<std::uint32_t>::max()) return res;
     std::uint32_t leaf_id = find_leaf(low);
     while (leaf_id != std::numeric_limits<std::uint32_t>::max()) {
-        Page& p = const_cast<BufferManager&>(buffer_).get_page(leaf_id);
+        ReadPageGuard guard(buffer_, leaf_id);
+        const Page& p = guard.page();
         const auto& h = hdr(p);
         const LeafEntry* es = leaf_entries(p);
         for (int i = leaf_lower_bound(p, low); i < h.count; ++i) {
@@ -250,16 +273,16 @@ std::vector<std::pair<Key, RID>> BPlusTreeT<Key, Comparator>::range(const Key& l
             RID r{es[i].page_id, es[i].slot_id};
             res.emplace_back(es[i].key, r);
         }
-        // cache next and stop condition BEFORE unpin to avoid accessing invalidated memory
+        // cache next and stop condition BEFORE release to avoid accessing invalidated memory
         std::uint32_t next = h.next;
         bool stop_after = false;
         if (h.count == 0) {
-            stop_after = true;
+            stop_after = false; // 删除后留下的空叶：继续看兄弟
         } else {
             const Key& last_key = es[h.count - 1].key;
             stop_after = comp_(high, last_key); // last_key > high
         }
-        const_cast<BufferManager&>(buffer_).unpin_page(leaf_id, false);
+        guard.release();//先放开当前叶再锁兄弟，同一时刻只持有一个叶闩
         if (stop_after) break;
         leaf_id = next;
     }
@@ -270,36 +293,32 @@ template <typename Key, typename Comparator>
 bool BPlusTreeT<Key, Comparator>::insert(const Key& key, const RID& rid) {
     if (root_ == std::numeric_limits<std::uint32_t>::max()) create();
     std::uint32_t leaf_id = find_leaf(key);
-    Page& leaf = buffer_.get_page(leaf_id);
+    WritePageGuard leaf(buffer_, leaf_id);
     if (trace_) {
         std::cout << "[B+Tree] insert(" << key << ") into leaf " << leaf_id << "\n";
     }
-    if (insert_in_leaf(leaf, leaf_id, key, rid)) {//最简单的情况，直接插入
-        if (trace_) {
-            std::cout << "[B+Tree]  -> inserted without split\n";
-        }
-        buffer_.unpin_page(leaf_id, true);
-        return true;
-    }
-    // Not inserted: either duplicate or leaf full. Check duplicate first.
+    // Check duplicate first, through the read-only view so a rejected insert leaves the page clean
     {
-        auto& h = hdr(leaf);
-        int pos = leaf_lower_bound(leaf, key);
-        const LeafEntry* es = leaf_entries(leaf);
-        if (pos < h.count && eq(es[pos].key, key)) {//检查重复键
+        const Page& v = leaf.view();
+        int pos = leaf_lower_bound(v, key);
+        if (pos < hdr(v).count && eq(leaf_entries(v)[pos].key, key)) {//检查重复键
             if (trace_) {
                 std::cout << "[B+Tree]  -> duplicate key, reject\n";
             }
-            buffer_.unpin_page(leaf_id, false);
             return false;
         }
     }
+    if (insert_in_leaf(leaf.page(), leaf_id, key, rid)) {//最简单的情况，直接插入
+        if (trace_) {
+            std::cout << "[B+Tree]  -> inserted without split\n";
+        }
+        return true;
+    }
     // Need to split
     if (trace_) {
         std::cout << "[B+Tree]  -> leaf full, need split\n";
     }
-    split_leaf_and_insert(leaf, leaf_id, key, rid);
-    buffer_.unpin_page(leaf_id, true);
+    split_leaf_and_insert(leaf, key, rid);
     return true;
 }
 
@@ -323,13 +342,16 @@ bool BPlusTreeT<Key, Comparator>::insert_in_leaf(Page& leaf, std::uint32_t /*lea
 }
 
 template <typename Key, typename Comparator>
-void BPlusTreeT<Key, Comparator>::split_leaf_and_insert(Page& leaf, std::uint32_t leaf_id, const Key& key, const RID& rid) {
+void BPlusTreeT<Key, Comparator>::split_leaf_and_insert(WritePageGuard& guard, const Key& key, const RID& rid) {
+    std::uint32_t leaf_id = guard.page_id();
+    Page& leaf = guard.page();
     auto& h = hdr(leaf);
     LeafEntry* es = leaf_entries(leaf);
 
     // create new right sibling
-    std::uint32_t right_id = disk_.allocate_page();//分配新页
-    Page& right = buffer_.get_page(right_id);//从缓存中获取该页
+    std::uint32_t right_id = allocate_node(true);//分配新页
+    WritePageGuard right_guard(buffer_, right_id);//新页尚未链接进树，别的线程看不到它
+    Page& right = right_guard.page();
     auto& hr = hdr(right);
     hr.is_leaf = 1; hr.count = 0; hr.parent = h.parent; hr.next = h.next;//初始化新页 叶结点， 无entity, 父节点与原节点相同，插入
 
@@ -357,13 +379,16 @@ void BPlusTreeT<Key, Comparator>::split_leaf_and_insert(Page& leaf, std::uint32_
 
     // promote split key = first key in right
     Key sep = rs[0].key;//最小搜索码值
+    std::uint32_t parent_id = h.parent;
     if (trace_) {
         std::cout << "[B+Tree]     split leaf " << leaf_id << " -> new right " << right_id
                   << ", sep key propagated\n";
     }
-    buffer_.unpin_page(right_id, true);
+    // 向上插入前放开两个叶：insert_in_parent 可能还要修改它们的 parent 字段
+    right_guard.release();
+    guard.release();
 
-    insert_in_parent(leaf_id, sep, right_id);
+    insert_in_parent(leaf_id, parent_id, sep, right_id);
 }
 
 template <typename Key, typename Comparator>
@@ -385,9 +410,11 @@ bool BPlusTreeT<Key, Comparator>::insert_in_internal(Page& page, std::uint32_t /
 
 template <typename Key, typename Comparator>
 //分裂内部节点并插入
-void BPlusTreeT<Key, Comparator>::split_internal_and_insert(Page& page, std::uint32_t pid, const Key& key, std::uint32_t right_id) {
+void BPlusTreeT<Key, Comparator>::split_internal_and_insert(WritePageGuard& guard, const Key& key, std::uint32_t right_id) {
     //数据结构：
     // children 是存储页索引的顺序表
+    std::uint32_t pid = guard.page_id();
+    Page& page = guard.page();
     auto& h = hdr(page);//page指向中间页
     InterEntry* es = inter_entries(page);
 
@@ -416,52 +443,57 @@ void BPlusTreeT<Key, Comparator>::split_internal_and_insert(Page& page, std::uin
     for (int i = 0; i < h.count; ++i) { es[i].key = keys[i]; es[i].child = children[i + 1]; }
 
     // Create right internal node
-    std::uint32_t right_pid = disk_.allocate_page();
-    Page& right = buffer_.get_page(right_pid);
-    auto& hr = hdr(right);
-    hr.is_leaf = 0;
-    hr.count = static_cast<std::uint16_t>(total - mid - 1);
-    hr.parent = h.parent;
-    hr.leftmost = children[mid + 1]; // first child on the right side (should be mid+1)
-    InterEntry* ers = inter_entries(right);
-    for (int i = 0; i < hr.count; ++i) { ers[i].key = keys[mid + 1 + i]; ers[i].child = children[mid + 1 + i + 1]; }
+    std::uint32_t right_pid = allocate_node(false);
+    std::uint32_t parent_id = h.parent;
+    {
+        WritePageGuard right_guard(buffer_, right_pid);
+        Page& right = right_guard.page();
+        auto& hr = hdr(right);
+        hr.is_leaf = 0;
+        hr.count = static_cast<std::uint16_t>(total - mid - 1);
+        hr.parent = parent_id;
+        hr.leftmost = children[mid + 1]; // first child on the right side (should be mid+1)
+        InterEntry* ers = inter_entries(right);
+        for (int i = 0; i < hr.count; ++i) { ers[i].key = keys[mid + 1 + i]; ers[i].child = children[mid + 1 + i + 1]; }
+    }
+    guard.release();//之后逐个锁孩子，不与父节点的闩同时持有
 
     // Update parent pointer of all children moved to the right internal node
     //更新右叶
     for (int cidx = mid + 1; cidx <= total; ++cidx) {
         std::uint32_t child_id = children[cidx];
-        Page& chp = buffer_.get_page(child_id);
-        hdr(chp).parent = right_pid;
-        buffer_.unpin_page(child_id, true);
+        WritePageGuard chp(buffer_, child_id);
+        hdr(chp.page()).parent = right_pid;
     }
 
     if (trace_) {
         std::cout << "[B+Tree]     split internal page " << pid << " -> new right " << right_pid
                   << ", promote sep to parent\n";
     }
-    buffer_.unpin_page(right_pid, true);
 
     // link new right into parent
-    insert_in_parent(pid, sep, right_pid);
+    insert_in_parent(pid, parent_id, sep, right_pid);
 }
 
 template <typename Key, typename Comparator>
-void BPlusTreeT<Key, Comparator>::insert_in_parent(std::uint32_t left_id, const Key& key, std::uint32_t right_id) {
+void BPlusTreeT<Key, Comparator>::insert_in_parent(std::uint32_t left_id, std::uint32_t parent_id, const Key& key, std::uint32_t right_id) {
+    // Callers hold no latch here; every page below is latched on its own, one at a time
     // if left is root
     if (left_id == root_) {//如果左节点是根节点
-        std::uint32_t new_root = disk_.allocate_page();//重新分配根页
-        Page& p = buffer_.get_page(new_root);//
-        auto& h = hdr(p);
-        h.is_leaf = 0; h.count = 0; h.parent = std::numeric_limits<std::uint32_t>::max();
-        h.leftmost = left_id; h.next = std::numeric_limits<std::uint32_t>::max();
-
-        InterEntry* es = inter_entries(p);
-        es[0].key = key; es[0].child = right_id; h.count = 1;
-        buffer_.unpin_page(new_root, true);
+        std::uint32_t new_root = allocate_node(false);//重新分配根页
+        {
+            WritePageGuard g(buffer_, new_root);
+            auto& h = hdr(g.page());
+            h.is_leaf = 0; h.count = 0; h.parent = std::numeric_limits<std::uint32_t>::max();
+            h.leftmost = left_id; h.next = std::numeric_limits<std::uint32_t>::max();
+
+            InterEntry* es = inter_entries(g.page());
+            es[0].key = key; es[0].child = right_id; h.count = 1;
+        }
 
         // update children parent for left and right
-        Page& l = buffer_.get_page(left_id); hdr(l).parent = new_root; buffer_.unpin_page(left_id, true);
-        Page& r = buffer_.get_page(right_id); hdr(r).parent = new_root; buffer_.unpin_page(right_id, true);
+        { WritePageGuard l(buffer_, left_id); hdr(l.page()).parent = new_root; }
+        { WritePageGuard r(buffer_, right_id); hdr(r.page()).parent = new_root; }
 
         root_ = new_root;
         if (trace_) {
@@ -470,22 +502,15 @@ void BPlusTreeT<Key, Comparator>::insert_in_parent(std::uint32_t left_id, const
         return;
     }
 
-    // get parent id from left node (temporary pin and immediately unpin to avoid extra pin leak)
-    Page& lpage = buffer_.get_page(left_id);
-    std::uint32_t parent_id = hdr(lpage).parent;
-    buffer_.unpin_page(left_id, false);
-
     // ensure right child's parent points to parent
     {
-        Page& r = buffer_.get_page(right_id);
-        hdr(r).parent = parent_id;
-        buffer_.unpin_page(right_id, true);
+        WritePageGuard r(buffer_, right_id);
+        hdr(r.page()).parent = parent_id;
     }
 
     // try simple insert in parent
-    Page& parent = buffer_.get_page(parent_id);
-    if (insert_in_internal(parent, parent_id, key, right_id)) {
-        buffer_.unpin_page(parent_id, true);
+    WritePageGuard parent(buffer_, parent_id);
+    if (insert_in_internal(parent.page(), parent_id, key, right_id)) {
         if (trace_) {
             std::cout << "[B+Tree]     inserted sep into parent " << parent_id << " without split\n";
         }
@@ -496,16 +521,30 @@ void BPlusTreeT<Key, Comparator>::insert_in_parent(std::uint32_t left_id, const
     if (trace_) {
         std::cout << "[B+Tree]     parent " << parent_id << " full, split needed\n";
     }
-    split_internal_and_insert(parent, parent_id, key, right_id);
-    buffer_.unpin_page(parent_id, true);
+    split_internal_and_insert(parent, key, right_id);
 }
 
 template <typename Key, typename Comparator>
 bool BPlusTreeT<Key, Comparator>::erase(const Key& key) {
-    // NOTE: deletion is not fully implemented in this simplified educational version
-    // You can extend this in the future.
-    (void)key;
-    return false;
+    if (root_ == std::numeric_limits<std::uint32_t>::max()) return false;
+    std::uint32_t leaf_id = find_leaf(key);
+    WritePageGuard leaf(buffer_, leaf_id);
+    int pos;
+    {
+        // 先经只读视图确认键存在，找不到时页保持干净
+        const Page& v = leaf.view();
+        pos = leaf_lower_bound(v, key);
+        if (pos >= hdr(v).count || !eq(leaf_entries(v)[pos].key, key)) return false;
+    }
+    Page& p = leaf.page();
+    auto& h = hdr(p);
+    LeafEntry* es = leaf_entries(p);
+    for (int i = pos; i < h.count - 1; ++i) es[i] = es[i + 1];
+    h.count--;
+    if (trace_) {
+        std::cout << "[B+Tree] erase(" << key << ") from leaf " << leaf_id << " (count=" << h.count << ")\n";
+    }
+    return true;
 }
 
 template <typename Key, typename Comparator>
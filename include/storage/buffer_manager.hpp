@@ -1,9 +1,18 @@
 #pragma once
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include <iostream>
@@ -14,17 +23,122 @@
 
 namespace pcsql {
 
+// View of one frame's bytes inside the buffer pool arena; size() is the database page size
+class PageData {
+public:
+    PageData() = default;
+    PageData(char* ptr, std::size_t size) : ptr_(ptr), size_(size) {}
+    char* data() { return ptr_; }
+    const char* data() const { return ptr_; }
+    std::size_t size() const { return size_; }
+    char& operator[](std::size_t i) { return ptr_[i]; }
+    const char& operator[](std::size_t i) const { return ptr_[i]; }
+
+private:
+    char* ptr_{nullptr};
+    std::size_t size_{0};
+};
+
 struct Page {
     std::uint32_t page_id{std::numeric_limits<std::uint32_t>::max()};
-    std::array<char, PAGE_SIZE> data{};//4096字节大小的数组
+    PageData data;//指向缓冲池中该帧的页字节（长度为 page_size）
+    // Per-frame reader/writer latch. Take it (shared to read, exclusive to modify) only while
+    // the page is pinned; the buffer pool takes it shared when writing the page back.
+    std::shared_mutex latch;
+    // Owner classification for the per-kind / per-table statistics (set by BufferManager::tag_page)
+    std::atomic<PageKind> kind{PageKind::Unknown};
+    std::atomic<std::int32_t> owner{-1};
+};
+
+// Background writer settings (BufferManager::start_background_writer).
+// Each round walks the frames in the order the replacement policy would evict them and writes
+// back dirty, unpinned ones: all of those among the first `lookahead` candidates, then more until
+// at most dirty_ratio_target * capacity frames are dirty, never exceeding max_pages_per_round.
+struct WriterOptions {
+    std::chrono::milliseconds interval{100}; // pause between rounds; a dirty eviction wakes the writer early
+    double dirty_ratio_target = 0.10;        // fraction of frames allowed to stay dirty
+    std::size_t lookahead = 0;               // next-victim frames kept clean; 0 = capacity / 8 (at least 1)
+    std::size_t max_pages_per_round = 64;    // write throttle
 };
 
+class BufferManager;
+
+// Access strategy for one sequential scan. Pages the scan loads live in a small private ring of
+// frames that the scan recycles itself, so they never enter the shared replacement lists; and the
+// next `readahead` pages of `pages` are read ahead asynchronously into a staging buffer.
+// Pass the context to BufferManager::get_page(page_id, scan) in the order of `pages`.
+// A ring frame that other threads pinned or touched is handed to the shared pool instead of
+// being recycled. On destruction the remaining ring frames become the pool's next victims.
+// Not thread-safe: one scanning thread per context.
+class ScanContext {
+public:
+    static constexpr std::size_t DEFAULT_RING = 16;
+    static constexpr std::size_t DEFAULT_READAHEAD = 8;
+
+    // ring_size is capped at a quarter of the pool (at least 1); readahead = 0 disables prefetching
+    ScanContext(BufferManager& buffer, std::vector<std::uint32_t> pages,
+                std::size_t ring_size = DEFAULT_RING, std::size_t readahead = DEFAULT_READAHEAD);
+    ~ScanContext();
+
+    ScanContext(const ScanContext&) = delete;
+    ScanContext& operator=(const ScanContext&) = delete;
+
+    const std::vector<std::uint32_t>& pages() const { return pages_; }
+    std::size_t ring_size() const { return ring_size_; }
+
+private:
+    friend class BufferManager;
+
+    // Readahead batch b covers pages_[b * readahead_, (b + 1) * readahead_) and is read into
+    // half b % 2 of stage_, so one batch can be consumed while the next is in flight.
+    struct StageHalf {
+        std::shared_ptr<IoBatch> io;
+        std::vector<std::uint32_t> epochs; // write epochs of the pages when their reads were issued
+    };
+    struct StagedPage {
+        std::size_t half;
+        std::size_t req;                   // index into the half's IoBatch requests
+    };
+
+    BufferManager& buffer_;
+    std::vector<std::uint32_t> pages_;
+    std::size_t pos_{0};                   // index in pages_ of the next expected access
+    std::size_t ring_size_;
+    std::vector<std::size_t> ring_;        // frame indices owned by this scan (guarded by pool_mu_)
+    std::size_t ring_next_{0};             // next ring frame to recycle
+    std::size_t readahead_;
+    std::size_t issued_{0};                // readahead batches issued so far
+    AlignedBuffer stage_;
+    StageHalf halves_[2];
+    std::unordered_map<std::uint32_t, StagedPage> staged_;
+};
+
+// Thread-safe, resizable buffer pool.
+// - frames live in chunks of CHUNK_FRAMES (each with its own page arena); chunks are added as the
+//   pool grows and are never moved or unmapped, shrinking only releases the page memory of retired frames;
+// - page table is split into SHARD_COUNT shards by page id, each with its own mutex;
+// - pin counts and dirty flags are atomics, every frame carries a shared_mutex (Page::latch);
+// - pool_mu_ guards the free-frame list and the replacement policy state.
+// Lock order: shard -> pool_mu_; eviction already holds pool_mu_ and therefore only
+// try_locks the victim's shard and latch, skipping busy victims. Flushes hold a page's
+// shared latch (never a pin) while writing it, which keeps the frame from being evicted.
 class BufferManager {
 public:
+    static constexpr std::size_t SHARD_COUNT = 16;
+    static constexpr std::size_t CHUNK_FRAMES = 64;
+    static constexpr std::size_t MAX_CHUNKS = 16384;
+    static constexpr std::size_t MAX_CAPACITY = CHUNK_FRAMES * MAX_CHUNKS;
+
     BufferManager(DiskManager& disk, std::size_t capacity, Policy policy = Policy::LRU, bool enable_logging = true);
+    ~BufferManager();
+
+    BufferManager(const BufferManager&) = delete;
+    BufferManager& operator=(const BufferManager&) = delete;
 
     // Pin and get a page from buffer (load from disk on miss)
-    Page& get_page(std::uint32_t page_id);
+    Page& get_page(std::uint32_t page_id) { return fetch(page_id, nullptr); }
+    // Same, for a sequential scan: a miss loads into the scan's ring (from its readahead when possible)
+    Page& get_page(std::uint32_t page_id, ScanContext& scan);
 
     // Unpin a page (dirty indicates if modified)
     void unpin_page(std::uint32_t page_id, bool dirty);
@@ -35,37 +149,249 @@ public:
     // Flush all dirty pages
     void flush_all();
 
-    const Stats& stats() const { return stats_; }
+    // Background writer thread (see WriterOptions); stopped by the destructor at the latest
+    void start_background_writer(const WriterOptions& opts = {});
+    void stop_background_writer();
+    bool background_writer_running() const { return writer_.joinable(); }
+    // One writer round, run on the calling thread; returns the number of pages written
+    std::size_t background_write_round(const WriterOptions& opts);
+    // Number of resident dirty frames (approximate while other threads run)
+    std::size_t dirty_pages() const;
+
+    // Resident page ids, most recently used first (as ranked by the replacement policy;
+    // frames of scan rings are left out)
+    std::vector<std::uint32_t> resident_pages();
+    // Warm-up file: save_warmup writes resident_pages() to `path`. start_warmup reads it back and
+    // loads the most recent entries that fit, in page-id order, on a background thread; it only
+    // fills free frames (never evicts) and skips pages that became resident meanwhile.
+    void save_warmup(const std::string& path);
+    void start_warmup(const std::string& path);
+    void wait_warmup();
+    void stop_warmup();
+
+    // Online resize to new_capacity frames. Growing adds free frames. Shrinking retires the frames
+    // above the new size: free ones at once, resident ones by evicting them (written back if dirty)
+    // once they are unpinned, and releases their page memory. Waits up to `timeout` for pinned
+    // frames to drain, then throws std::runtime_error; frames still resident then are retired
+    // when they are next evicted (or by a later resize to the same size). Resizes are serialized;
+    // other operations keep running.
+    void resize(std::size_t new_capacity, std::chrono::milliseconds timeout = std::chrono::seconds(10));
+
+    // Memory-budget sizing: the cgroup (v2 or v1) memory limit of this process, if any
+    static std::optional<std::size_t> cgroup_memory_limit();
+    // Frames for `fraction` of the cgroup limit (physical memory when unlimited), within [64, MAX_CAPACITY]
+    static std::size_t auto_capacity(std::size_t page_size, double fraction = 0.25);
+
+    // Snapshot of the counters (they are updated concurrently)
+    Stats stats() const;
+    // Counters per page kind and per owning table plus the miss latency histogram
+    BufferStatus status();
+    // Record what a page holds (table_id < 0: no owning table). Tags outlive evictions;
+    // PageKind::Unknown drops the tag (e.g. when the page is freed).
+    void tag_page(std::uint32_t page_id, PageKind kind, std::int32_t table_id = -1);
+    // The page is being freed: zero its resident frame (if any) in place, clear the dirty bit and
+    // drop its tag, so a later get_page after the id is recycled sees an empty page instead of
+    // the old contents. Throws std::logic_error when the page is pinned.
+    void discard_page(std::uint32_t page_id);
     Policy policy() const { return policy_; }
-    std::size_t capacity() const { return capacity_; }
+    std::size_t capacity() const { return capacity_.load(); }
+    std::size_t page_size() const { return page_size_; }
 
 private:
     struct Frame {
         Page page;
-        bool dirty{false};
-        int pin_count{0};
-        // When not pinned, the frame index appears in repl_list_
+        std::atomic<bool> dirty{false};
+        std::atomic<int> pin_count{0};
+        // LRU/FIFO: when not pinned, the frame index appears in repl_list_.
+        // CLOCK: resident frames are swept by clock_hand_; usage is bumped on every access
+        // (saturating at CLOCK_MAX_USAGE) and decremented as the hand passes, so a frame is a
+        // victim once it has gone a full sweep unreferenced (usage == 0 acts as a cleared reference bit).
+        // usage also counts hits on ring frames: a scan does not recycle a frame others touched
+        std::atomic<bool> resident{false};
+        std::atomic<std::uint8_t> usage{0};
+        // Mapped but being loaded, or written back before eviction: the I/O thread holds the exclusive
+        // latch without the shard lock; hits pin the frame and wait on the latch (set under the shard lock)
+        std::atomic<bool> busy{false};
+        bool in_ring{false}; // owned by a ScanContext ring, outside the replacement lists (guarded by pool_mu_)
+        bool retired{false}; // above capacity_ after a shrink: not free, not resident, memory released (pool_mu_)
+    };
+
+    struct Chunk {
+        Chunk(std::size_t page_size);
+        ~Chunk();
+        Chunk(const Chunk&) = delete;
+        Chunk& operator=(const Chunk&) = delete;
+        std::unique_ptr<Frame[]> frames;
+        char* arena{nullptr};                   // mmap'd CHUNK_FRAMES * page_size bytes (page-aligned for O_DIRECT)
+        std::size_t bytes{0};
+    };
+
+    static constexpr std::uint8_t CLOCK_MAX_USAGE = 5;
+
+    struct PageTag {
+        PageKind kind{PageKind::Unknown};
+        std::int32_t owner{-1};
+    };
+
+    struct Shard {
+        std::mutex mu;
+        std::unordered_map<std::uint32_t, std::size_t> table; // page_id -> frame index
+        // Statistics breakdown, updated under mu on hit/miss/eviction (no shared counters on the hot path)
+        std::unordered_map<std::uint32_t, PageTag> tags;      // page_id -> owner, resident or not
+        std::array<PageCounters, PAGE_KIND_COUNT> kind_counters{};
+        std::unordered_map<std::int32_t, PageCounters> table_counters;
+    };
+
+    struct AtomicStats {
+        std::atomic<std::size_t> hits{0};
+        std::atomic<std::size_t> misses{0};
+        std::atomic<std::size_t> evictions{0};
+        std::atomic<std::size_t> flushes{0};
+        std::atomic<std::size_t> background_flushes{0};
+        std::atomic<std::size_t> dirty_evictions{0};
+        std::atomic<std::size_t> readahead_hits{0};
+        std::atomic<std::size_t> prewarmed{0};
     };
 
-    // replacement helpers
+    // Write epochs (hashed by page id) are bumped before and after every write-back. A readahead
+    // copy is used only if its page's epoch did not move since the read was issued, i.e. no write
+    // of that page overlapped or followed the read.
+    static constexpr std::size_t EPOCH_SLOTS = 256;
+    std::atomic<std::uint32_t>& write_epoch(std::uint32_t page_id) { return write_epochs_[page_id % EPOCH_SLOTS]; }
+
+    Shard& shard_of(std::uint32_t page_id) { return shards_[page_id % SHARD_COUNT]; }
+    // Frames are only reached through indices published under a shard lock or pool_mu_
+    Frame& frame(std::size_t idx) const {
+        return chunks_[idx / CHUNK_FRAMES].load(std::memory_order_acquire)->frames[idx % CHUNK_FRAMES];
+    }
+    // Resize helpers (caller holds pool_mu_)
+    void add_frames(std::size_t frames);
+    void retire_frame(std::size_t idx);
+    void remove_from_policy(std::size_t idx);
+    void set_policy_limits();
+    // Evict a resident frame above capacity_ for a shrink; false if it is pinned or busy
+    bool drain_frame(std::uint32_t page_id, std::size_t idx);
+
+    Page& fetch(std::uint32_t page_id, ScanContext* scan);
+
+    // replacement helpers (caller holds pool_mu_)
     void on_unpinned(std::size_t frame_idx);
-    std::size_t pick_victim();
-    void log(const std::string& msg) const { if (enable_logging_) std::cout << msg << std::endl; }
+    // Take a free frame or evict a victim; the caller holds no shard lock (a dirty victim is written
+    // back with its shard unlocked). The returned frame is unmapped and already pinned once so
+    // concurrent sweeps skip it while it loads.
+    // With a scan, a full ring recycles its own next frame and new frames join the ring.
+    std::size_t acquire_frame(ScanContext* scan);
+    // Drop a frame from the scan's ring / give an unmapped, unpinned frame back to the free list,
+    // or retire it when above capacity_ (caller holds pool_mu_)
+    void leave_ring(ScanContext& scan, std::size_t idx);
+    void release_frame(std::size_t idx);
+    // Hand a ring frame back to the replacement policy: as the next victim, or as recently used if hot
+    // (caller holds pool_mu_)
+    void demote_ring_frame(std::size_t frame_idx, bool hot);
+
+    // Scan support (ScanContext)
+    void scan_advance(ScanContext& scan, std::uint32_t page_id);
+    void issue_readahead(ScanContext& scan, std::size_t batch);
+    bool take_staged(ScanContext& scan, std::uint32_t page_id, char* dst);
+    void end_scan(ScanContext& scan);
+    friend class ScanContext;
+    // Victim search (caller holds pool_mu_). On success the victim's shard and its latch are
+    // locked into vl/latch.
+    bool pick_from_list(std::size_t& idx, std::unique_lock<std::mutex>& vl,
+                        std::unique_lock<std::shared_mutex>& latch, bool& contended);
+    bool pick_two_q(std::size_t& idx, std::unique_lock<std::mutex>& vl,
+                    std::unique_lock<std::shared_mutex>& latch, bool& contended);
+    // 2Q bookkeeping (caller holds pool_mu_)
+    void two_q_admit(std::size_t frame_idx, std::uint32_t page_id);
+    void two_q_touch(std::size_t frame_idx);
+    void two_q_remember(std::uint32_t page_id);
+    bool pick_clock(std::size_t& idx, std::unique_lock<std::mutex>& vl,
+                    std::unique_lock<std::shared_mutex>& latch, bool& contended);
+    // Frame indices in the order the policy would pick victims (caller holds pool_mu_)
+    std::vector<std::size_t> eviction_order() const;
+    // Write back the given (page_id, frame) pairs in one batch under shared latches. Pages whose
+    // latch is busy go to `deferred` when given, otherwise they are skipped. Returns pages written.
+    std::size_t write_back(const std::vector<std::pair<std::uint32_t, std::size_t>>& pages,
+                           std::vector<std::uint32_t>* deferred);
+    void writer_loop(WriterOptions opts);
+    void warmup_loop(std::vector<std::uint32_t> pages);
+    // Install a page read by the warm-up thread into a free frame. Returns false once no free
+    // frame is left; a page that is already resident or was written since `epoch` is skipped.
+    bool install_page(std::uint32_t page_id, const char* data, std::uint32_t epoch);
+    bool try_claim(std::size_t idx, std::unique_lock<std::mutex>& vl,
+                   std::unique_lock<std::shared_mutex>& latch, bool& contended);
+    void touch_clock(Frame& f) {
+        std::uint8_t u = f.usage.load(std::memory_order_relaxed);
+        while (u < CLOCK_MAX_USAGE && !f.usage.compare_exchange_weak(u, u + 1, std::memory_order_relaxed)) {}
+    }
+    // Caller holds the page's shard lock
+    void count(Shard& sh, const Page& page, std::size_t PageCounters::*field) {
+        ++(sh.kind_counters[static_cast<std::size_t>(page.kind.load(std::memory_order_relaxed))].*field);
+        std::int32_t owner = page.owner.load(std::memory_order_relaxed);
+        if (owner >= 0) ++(sh.table_counters[owner].*field);
+    }
+    void record_miss_latency(std::chrono::steady_clock::duration d) {
+        auto us = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+        miss_latency_[LatencyHistogram::bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+        miss_latency_us_.fetch_add(us, std::memory_order_relaxed);
+    }
+    // The message is only formatted when logging is enabled
+    template <typename... Parts>
+    void log(const Parts&... parts) const {
+        if (!enable_logging_) return;
+        std::ostringstream os;
+        (os << ... << parts);
+        std::lock_guard<std::mutex> lk(log_mu_);
+        std::cout << os.str() << std::endl;
+    }
 
     DiskManager& disk_;
-    std::size_t capacity_;
+    std::atomic<std::size_t> capacity_;         // active frames; indices >= capacity_ are retired or retiring
     Policy policy_;
     bool enable_logging_;
-    Stats stats_{};
+    AtomicStats stats_;
+    mutable std::mutex log_mu_;
 
-    std::vector<Frame> frames_;                 // fixed size
-    std::vector<bool> used_;                    // whether frame slot is used
-    std::vector<std::size_t> free_list_;        // indices of free frames
-    std::unordered_map<std::uint32_t, std::size_t> page_table_; // page_id -> frame index
+    std::array<std::atomic<std::uint32_t>, EPOCH_SLOTS> write_epochs_{};
+    std::array<std::atomic<std::size_t>, LatencyHistogram::BUCKETS> miss_latency_{};
+    std::atomic<std::uint64_t> miss_latency_us_{0};
 
+    std::size_t page_size_;
+    // chunk c holds frames [c * CHUNK_FRAMES, (c + 1) * CHUNK_FRAMES); slots are filled under pool_mu_
+    // and never cleared before destruction (frames hold latches, so they never move)
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks_;
+    std::atomic<std::size_t> frame_limit_{0};   // frames backed by chunks (only grows)
+    std::mutex resize_mu_;                      // serializes resize()
+    std::array<Shard, SHARD_COUNT> shards_;
+
+    std::mutex pool_mu_;
+    std::vector<std::size_t> free_list_;        // indices of free frames
     // For LRU/FIFO among frames; front = victim candidate
     std::list<std::size_t> repl_list_; // holds frame indices
     std::unordered_map<std::size_t, std::list<std::size_t>::iterator> repl_pos_; // frame_idx -> iterator
+    std::size_t clock_hand_{0};                 // CLOCK: next frame the sweep inspects
+
+    // 2Q: frames stay in their queue while pinned (try_claim skips pinned frames)
+    enum class TwoQQueue : std::uint8_t { None, A1in, Am };
+    std::size_t a1in_target_{1};                // Kin: A1in is preferred for eviction while above this
+    std::size_t a1out_limit_{1};                // Kout: ghost entries kept
+    std::list<std::size_t> a1in_;               // FIFO of frames touched once
+    std::list<std::size_t> am_;                 // LRU of re-referenced frames, front = victim
+    std::vector<TwoQQueue> q_where_;            // frame_idx -> queue
+    std::vector<std::list<std::size_t>::iterator> q_pos_; // frame_idx -> position in its queue
+    std::list<std::uint32_t> a1out_;            // ghost page ids, front = oldest
+    std::unordered_map<std::uint32_t, std::list<std::uint32_t>::iterator> a1out_pos_;
+
+    // Background writer
+    std::thread writer_;
+    std::mutex writer_mu_;
+    std::condition_variable writer_cv_;
+    bool writer_stop_{false};                   // guarded by writer_mu_
+    std::atomic<bool> writer_kick_{false};      // set by dirty evictions to start a round early
+
+    // Warm-up
+    std::thread warmup_;
+    std::atomic<bool> warmup_stop_{false};
 };
 
 } // namespace pcsql
\ No newline at end of file
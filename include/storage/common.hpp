@@ -1,20 +1,37 @@
 #pragma once
+#include <array>
 #include <cstddef>
+#include <cstdint>
+#include <map>
 #include <string>
 
 namespace pcsql {
 
-constexpr std::size_t PAGE_SIZE = 4096; // 4KB
+// Page size is a per-database setting recorded in the data.db superblock;
+// DEFAULT_PAGE_SIZE is only used when a new database is formatted.
+constexpr std::size_t DEFAULT_PAGE_SIZE = 4096;   // 4KB
+constexpr std::size_t MIN_PAGE_SIZE = 4096;
+constexpr std::size_t MAX_PAGE_SIZE = 64 * 1024;  // slot offsets are uint16
+
+inline bool valid_page_size(std::size_t n) {
+    return n >= MIN_PAGE_SIZE && n <= MAX_PAGE_SIZE && (n & (n - 1)) == 0;
+}
 
 enum class Policy {
     LRU,
-    FIFO
+    FIFO,
+    CLOCK,  // clock sweep over frames with per-frame usage counts; no per-access allocation
+    TWO_Q   // 2Q: first-touch pages in a small FIFO (A1in), re-referenced pages in an LRU (Am);
+            // a ghost list (A1out) of recently evicted A1in page ids decides promotion, so one-off scans
+            // cycle through A1in without displacing the hot set
 };
 
 inline const char* to_string(Policy p) {
     switch (p) {
         case Policy::LRU: return "LRU";
         case Policy::FIFO: return "FIFO";
+        case Policy::CLOCK: return "CLOCK";
+        case Policy::TWO_Q: return "2Q";
     }
     return "UNKNOWN";
 }
@@ -23,7 +40,80 @@ struct Stats {
     std::size_t hits{0};
     std::size_t misses{0};
     std::size_t evictions{0};
-    std::size_t flushes{0};
+    std::size_t flushes{0};            // all page write-backs (eviction, flush_*, background writer)
+    std::size_t background_flushes{0}; // written by the background writer
+    std::size_t dirty_evictions{0};    // evictions that had to write the victim first
+    std::size_t readahead_hits{0};     // scan misses served from a ScanContext readahead copy
+    std::size_t prewarmed{0};          // pages loaded by the warm-up thread
+};
+
+// What a page holds, for the per-kind buffer statistics. Pages are tagged by their owner
+// (RecordManager / B+Tree / StorageEngine via BufferManager::tag_page); untagged pages count as Unknown.
+enum class PageKind : std::uint8_t {
+    Unknown,
+    Heap,          // record pages of a user table
+    Catalog,       // record pages of a sys_* catalog table
+    IndexInternal, // B+Tree internal node
+    IndexLeaf,     // B+Tree leaf
+    Overflow       // chain page of an out-of-line column value (OverflowStore)
+};
+constexpr std::size_t PAGE_KIND_COUNT = 6;
+
+inline const char* to_string(PageKind k) {
+    switch (k) {
+        case PageKind::Unknown: return "unknown";
+        case PageKind::Heap: return "heap";
+        case PageKind::Catalog: return "catalog";
+        case PageKind::IndexInternal: return "index_internal";
+        case PageKind::IndexLeaf: return "index_leaf";
+        case PageKind::Overflow: return "overflow";
+    }
+    return "unknown";
+}
+
+struct PageCounters {
+    std::size_t hits{0};
+    std::size_t misses{0};
+    std::size_t evictions{0};
+};
+
+// Miss latency (time to bring a page in: disk read or readahead copy), log2 buckets of microseconds:
+// bucket 0 counts misses under 1us, bucket b (b >= 1) those in [2^(b-1), 2^b) us, the last one everything above.
+struct LatencyHistogram {
+    static constexpr std::size_t BUCKETS = 24;
+    std::array<std::size_t, BUCKETS> buckets{};
+    std::size_t count{0};
+    std::uint64_t total_us{0};
+
+    static std::size_t bucket_of(std::uint64_t us) {
+        std::size_t b = 0;
+        while (us > 0 && b + 1 < BUCKETS) { us >>= 1; ++b; }
+        return b;
+    }
+    // Upper bound (us) of bucket b
+    static std::uint64_t bucket_limit(std::size_t b) { return std::uint64_t{1} << b; }
+    // Upper bound of the bucket holding the p-th percentile (0 when empty)
+    std::uint64_t percentile(double p) const {
+        if (count == 0) return 0;
+        auto rank = static_cast<std::size_t>(p / 100.0 * static_cast<double>(count - 1)) + 1;
+        std::size_t seen = 0;
+        for (std::size_t b = 0; b < BUCKETS; ++b) {
+            seen += buckets[b];
+            if (seen >= rank) return bucket_limit(b);
+        }
+        return bucket_limit(BUCKETS - 1);
+    }
+};
+
+// Buffer pool statistics broken down by page kind and owning table (BufferManager::status)
+struct BufferStatus {
+    Stats totals;
+    std::size_t capacity{0};
+    std::size_t resident{0};
+    std::size_t dirty{0};
+    std::array<PageCounters, PAGE_KIND_COUNT> by_kind{};     // indexed by PageKind
+    std::map<std::int32_t, PageCounters> by_table;           // table id -> counters (heap, catalog and index pages)
+    LatencyHistogram miss_latency;
 };
 
 } // namespace pcsql
\ No newline at end of file
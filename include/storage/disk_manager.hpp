@@ -1,44 +1,154 @@
 #pragma once
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "storage/aligned_buffer.hpp"
+#include "storage/async_io.hpp"
 #include "storage/common.hpp"
 
 namespace pcsql {
 
+struct DiskOptions {
+    // Page size used when formatting a new data.db (4/8/16/32/64 KB); an existing file
+    // keeps the size recorded in its superblock
+    std::size_t page_size = DEFAULT_PAGE_SIZE;
+    // data.db grows in extents of this many bytes (rounded to whole pages, clamped to
+    // [page_size, MAX_EXTENT_BYTES]); new pages are handed out from the reserved extent
+    std::size_t extent_bytes = std::size_t{1} << 20;
+    // Backend for batched page I/O (submit_async); the engine is created on first use
+    IoBackend io_backend = IoBackend::Auto;
+    std::size_t io_threads = 4;
+    // Open data.db with O_DIRECT so pages are cached only in the buffer pool. Falls back to
+    // buffered I/O when the filesystem rejects O_DIRECT (e.g. tmpfs); see direct_io().
+    bool direct_io = false;
+};
+
+// On-disk layout of data.db (all space-management state is binary, inside the file):
+//   page 0             : superblock (magic, version, page size, next_page_id, bitmap count)
+//   page 1             : free-page bitmap for group 0 (page ids [0, bits_per_map))
+//   page k*bits_per_map: free-page bitmap for group k (k >= 1), i.e. the first page of its group
+// bits_per_map = page_size * 8, so the grouping follows the database's page size.
+// A set bit means the page is in use. Bitmap placement is deterministic, so the
+// superblock only records how many groups exist.
 class DiskManager {
 public:
+    static constexpr std::size_t MAX_EXTENT_BYTES = std::size_t{64} << 20;
+
     explicit DiskManager(const std::string& base_dir = ".",
                          const std::string& db_file = "data.db",
-                         const std::string& meta_file = "meta.json");
+                         const DiskOptions& options = {});
+    ~DiskManager();
+
+    DiskManager(const DiskManager&) = delete;
+    DiskManager& operator=(const DiskManager&) = delete;
+
+    // allocate_page/free_page/sync serialize on an internal mutex; read_page/write_page are
+    // positional and may run concurrently from many threads.
 
     // Allocate a page and return page id
     std::uint32_t allocate_page();
 
-    // Free page id (add to free list)
+    // Free page id (clear its bit in the space map)
     void free_page(std::uint32_t page_id);
+    // Same for several pages, writing each touched bitmap page once. Throws std::invalid_argument,
+    // freeing none of them, when any id is not an allocatable page.
+    void free_pages(const std::vector<std::uint32_t>& page_ids);
+
+    // Whether page_id is an allocated data page (false for free, metadata or out-of-range ids)
+    bool is_allocated(std::uint32_t page_id);
+
+    // Read/Write one page (page_size() bytes). In direct-I/O mode unaligned buffers go
+    // through an aligned bounce buffer; the buffer pool arena is always aligned.
+    void read_page(std::uint32_t page_id, void* out_buffer);
+    void write_page(std::uint32_t page_id, const void* buffer);
+
+    // Submit a batch of page reads/writes without blocking. Reads must target existing
+    // pages; writes past EOF grow the file first. Buffers must outlive the batch and, in
+    // direct-I/O mode, be AlignedBuffer::ALIGNMENT-aligned.
+    std::shared_ptr<IoBatch> submit_async(std::vector<IoRequest> reqs);
+    const char* io_backend_name();
 
-    // Read/Write fixed-size page
-    void read_page(std::uint32_t page_id, void* out_buffer, std::size_t size = PAGE_SIZE);
-    void write_page(std::uint32_t page_id, const void* buffer, std::size_t size = PAGE_SIZE);
+    // Write the superblock and pending bitmap changes back to data.db (also done on destruction).
+    // A page id handed out is already marked in use on disk: free_page and the reuse of a freed
+    // page write their bitmap page through, and a fresh page from a new extent writes it once with
+    // the rest of that extent marked in use as well. After a crash next_page_id is recomputed from
+    // the highest page marked in use, so at most one extent of never-used pages stays marked.
+    void sync();
+
+    // Validate the superblock of an existing data.db and return its page size (no space map load)
+    static std::size_t probe_page_size(const std::filesystem::path& db_path);
 
     std::filesystem::path db_path() const { return db_path_; }
+    std::size_t page_size() const { return page_size_; }
+    bool direct_io() const { return direct_io_; }
+    std::size_t extent_bytes() const { return extent_pages_ * page_size_; }
 
 private:
-    void init_files();
-    void load_meta();
-    void save_meta() const;
+    static constexpr std::uint32_t SUPERBLOCK_PAGE = 0;
+
+    struct SuperBlock {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t page_size;
+        std::uint32_t next_page_id;
+        std::uint32_t bitmap_count;
+    };
+
+    std::uint32_t bitmap_page_of(std::uint32_t group) const {
+        return group == 0 ? 1u : group * bits_per_map_;
+    }
+
+    static void check_superblock(const SuperBlock& sb, const std::filesystem::path& where);
+
+    void init_files(bool want_direct);
+    void format_new();
+    void load_space_map(std::size_t requested_page_size);
+    void set_page_size(std::size_t page_size);
+    void add_bitmap_group();
+    bool test_bit(std::uint32_t page_id) const;
+    void set_bit(std::uint32_t page_id, bool used);
+    // Callers hold space_mu_
+    void write_bitmaps();
+    void write_superblock();
     void ensure_file_size_for(std::uint32_t page_id);
+    void zero_page(std::uint32_t page_id);
+    AsyncIoEngine& aio();
 
     std::filesystem::path base_dir_;
     std::filesystem::path db_path_;
-    std::filesystem::path meta_path_;
 
+    // data.db stays open for the lifetime of the manager; page I/O is positional
+    // (pread/pwrite), and the file size is cached so bounds checks need no syscall.
+    int fd_{-1};
+    bool direct_io_{false};
+    std::atomic<std::uint64_t> file_size_{0};
+    std::size_t page_size_{DEFAULT_PAGE_SIZE};
+    std::uint32_t bits_per_map_{static_cast<std::uint32_t>(DEFAULT_PAGE_SIZE * 8)};
+    std::size_t words_per_map_{DEFAULT_PAGE_SIZE / sizeof(std::uint64_t)};
+    std::size_t extent_request_{0};
+    std::uint32_t extent_pages_{1};
+
+    std::mutex space_mu_;   // guards the space map, next_page_id_ and file growth
     std::uint32_t next_page_id_{0};
+    // [next_page_id_, reserved_end_) is marked in use in the on-disk bitmap but not in bitmaps_
+    std::uint32_t reserved_end_{0};
+    bool super_dirty_{false};
+    // Space map cached in memory; only the bitmap pages touched since the last write are rewritten
+    std::vector<std::vector<std::uint64_t>> bitmaps_;
+    std::vector<bool> bitmap_dirty_;
+    // Free page ids rebuilt from the bitmaps at startup; allocate/free are O(1) stack ops
     std::vector<std::uint32_t> free_list_;
+
+    IoBackend io_backend_{IoBackend::Auto};
+    std::size_t io_threads_{4};
+    std::once_flag aio_once_;
+    std::unique_ptr<AsyncIoEngine> aio_;
 };
 
-} // namespace pcsql
\ No newline at end of file
+} // namespace pcsql
@@ -0,0 +1,50 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <unordered_map>
+
+namespace pcsql {
+
+// Approximate free space of table pages, used by RecordManager::insert to go straight to a page
+// with room instead of pinning every page of the table.
+// Free bytes are kept as one of CATEGORIES buckets (page_size / CATEGORIES bytes each, rounded
+// down), so a page in category c has at least c * step bytes free when it was last seen.
+// The map lives in memory only: it is filled as pages are written or scanned, and pages it has
+// not seen yet (e.g. after a restart) are simply not offered. Thread-safe.
+class FreeSpaceMap {
+public:
+    static constexpr std::size_t CATEGORIES = 256;
+
+    explicit FreeSpaceMap(std::size_t page_size);
+
+    // Record the free bytes of a table page as seen just now
+    void update(std::int32_t table_id, std::uint32_t page_id, std::size_t free_bytes);
+    // Same for a page already in the map (callers that only have a RID); unknown pages are ignored
+    void refresh(std::uint32_t page_id, std::size_t free_bytes);
+    // Best fit: a page of the table whose recorded category guarantees `need` bytes, or nullopt
+    std::optional<std::uint32_t> find(std::int32_t table_id, std::size_t need) const;
+    bool known(std::int32_t table_id, std::uint32_t page_id) const;
+    void forget(std::int32_t table_id, std::uint32_t page_id);
+    void drop_table(std::int32_t table_id);
+
+private:
+    struct PageEntry {
+        std::int32_t table_id;
+        std::uint8_t category;
+    };
+    using TableSpace = std::array<std::set<std::uint32_t>, CATEGORIES>; // category -> page ids
+
+    std::uint8_t category(std::size_t free_bytes) const;
+    void set_category(PageEntry& e, std::uint32_t page_id, std::uint8_t c); // caller holds mu_
+
+    std::size_t step_;
+    mutable std::mutex mu_;
+    std::unordered_map<std::uint32_t, PageEntry> entries_;  // page_id -> owner and category
+    std::unordered_map<std::int32_t, TableSpace> tables_;
+};
+
+} // namespace pcsql
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace pcsql {
+
+// Read-only, memory-mapped view of data.db for reporting/analytics. page() returns a
+// pointer straight into the mapping (no copy, no buffer pool frame). Intended for
+// snapshot copies of a database directory or a database no writer is using: pages
+// still dirty in a live BufferManager are not visible, and the mapping covers the file
+// size at open time.
+class MappedDiskReader {
+public:
+    explicit MappedDiskReader(const std::string& base_dir = ".",
+                              const std::string& db_file = "data.db");
+    ~MappedDiskReader();
+
+    MappedDiskReader(const MappedDiskReader&) = delete;
+    MappedDiskReader& operator=(const MappedDiskReader&) = delete;
+
+    // Zero-copy page access; throws std::out_of_range past the mapped size
+    const char* page(std::uint32_t page_id) const;
+    // Copying read with the same contract as DiskManager::read_page
+    void read_page(std::uint32_t page_id, void* out_buffer) const;
+
+    // madvise hints: whole-file sequential readahead for full scans, or prefetch a run of pages
+    void advise_sequential() const;
+    void advise_willneed(std::uint32_t first_page, std::uint32_t count) const;
+
+    std::size_t page_size() const { return page_size_; }
+    std::uint32_t page_count() const { return static_cast<std::uint32_t>(size_ / page_size_); }
+    std::filesystem::path db_path() const { return db_path_; }
+
+private:
+    std::filesystem::path db_path_;
+    int fd_{-1};
+    const char* base_{nullptr};
+    std::size_t size_{0};
+    std::size_t page_size_{0};
+};
+
+} // namespace pcsql
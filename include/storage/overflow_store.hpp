@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "storage/buffer_manager.hpp"
+#include "storage/disk_manager.hpp"
+
+namespace pcsql {
+
+// In-row pointer to a value stored out of line (see OverflowStore)
+struct OverflowRef {
+    std::uint32_t first_page{0};
+    std::uint32_t length{0};
+};
+
+// Out-of-line storage for large column values. A value is split over a chain of pages, each
+// [u32 next page id (0 = last)][u16 bytes used][data]. Pages come straight from DiskManager and
+// are tagged PageKind::Overflow with the owning table; they are not in the table's page list, so
+// scans never touch them, and the owner frees a chain when its row is deleted or rewritten or
+// the table is dropped.
+class OverflowStore {
+public:
+    OverflowStore(DiskManager& disk, BufferManager& buffer) : disk_(disk), buffer_(buffer) {}
+
+    OverflowRef write(std::int32_t table_id, std::string_view value);
+    // Throws std::runtime_error when the chain is shorter than ref.length
+    std::string read(const OverflowRef& ref) const;
+    // Zero and free every page of the chain (a freed page that is reused starts out empty)
+    void free(const OverflowRef& ref);
+
+    std::size_t bytes_per_page() const { return buffer_.page_size() - HEADER; }
+
+private:
+    static constexpr std::size_t HEADER = sizeof(std::uint32_t) + sizeof(std::uint16_t);
+
+    DiskManager& disk_;
+    BufferManager& buffer_;
+};
+
+} // namespace pcsql
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#include "storage/buffer_manager.hpp"
+
+namespace pcsql {
+
+// RAII handles over BufferManager pins.
+// A guard pins the page on construction and takes its latch (shared for ReadPageGuard,
+// exclusive for WritePageGuard); destruction or release() drops the latch and unpins.
+// WritePageGuard marks the page dirty as soon as it hands out mutable access, so callers
+// never pass a dirty flag by hand and early returns / exceptions cannot leak a pin.
+// A thread must not hold two guards on the same page (latches are not recursive).
+
+class ReadPageGuard {
+public:
+    ReadPageGuard() = default;
+    ReadPageGuard(BufferManager& buffer, std::uint32_t page_id)
+        : buffer_(&buffer), page_(&buffer.get_page(page_id)) {
+        try {
+            page_->latch.lock_shared();
+        } catch (...) {
+            buffer.unpin_page(page_id, false);
+            throw;
+        }
+    }
+    // Sequential-scan variant: a miss loads into the scan's ring (see ScanContext)
+    ReadPageGuard(BufferManager& buffer, std::uint32_t page_id, ScanContext& scan)
+        : buffer_(&buffer), page_(&buffer.get_page(page_id, scan)) {
+        try {
+            page_->latch.lock_shared();
+        } catch (...) {
+            buffer.unpin_page(page_id, false);
+            throw;
+        }
+    }
+    ~ReadPageGuard() { release(); }
+
+    ReadPageGuard(const ReadPageGuard&) = delete;
+    ReadPageGuard& operator=(const ReadPageGuard&) = delete;
+    ReadPageGuard(ReadPageGuard&& o) noexcept
+        : buffer_(std::exchange(o.buffer_, nullptr)), page_(std::exchange(o.page_, nullptr)) {}
+    ReadPageGuard& operator=(ReadPageGuard&& o) noexcept {
+        if (this != &o) {
+            release();
+            buffer_ = std::exchange(o.buffer_, nullptr);
+            page_ = std::exchange(o.page_, nullptr);
+        }
+        return *this;
+    }
+
+    // Unlatch and unpin early; the guard becomes empty
+    void release() {
+        if (!page_) return;
+        std::uint32_t pid = page_->page_id;
+        page_->latch.unlock_shared();
+        page_ = nullptr;
+        buffer_->unpin_page(pid, false);
+    }
+
+    explicit operator bool() const { return page_ != nullptr; }
+    const Page& page() const { return *page_; }
+    const char* data() const { return page_->data.data(); }
+    std::uint32_t page_id() const { return page_ ? page_->page_id : std::numeric_limits<std::uint32_t>::max(); }
+
+private:
+    BufferManager* buffer_{nullptr};
+    Page* page_{nullptr};
+};
+
+class WritePageGuard {
+public:
+    WritePageGuard() = default;
+    WritePageGuard(BufferManager& buffer, std::uint32_t page_id)
+        : buffer_(&buffer), page_(&buffer.get_page(page_id)) {
+        try {
+            page_->latch.lock();
+        } catch (...) {
+            buffer.unpin_page(page_id, false);
+            throw;
+        }
+    }
+    ~WritePageGuard() { release(); }
+
+    WritePageGuard(const WritePageGuard&) = delete;
+    WritePageGuard& operator=(const WritePageGuard&) = delete;
+    WritePageGuard(WritePageGuard&& o) noexcept
+        : buffer_(std::exchange(o.buffer_, nullptr)), page_(std::exchange(o.page_, nullptr)),
+          dirty_(std::exchange(o.dirty_, false)) {}
+    WritePageGuard& operator=(WritePageGuard&& o) noexcept {
+        if (this != &o) {
+            release();
+            buffer_ = std::exchange(o.buffer_, nullptr);
+            page_ = std::exchange(o.page_, nullptr);
+            dirty_ = std::exchange(o.dirty_, false);
+        }
+        return *this;
+    }
+
+    void release() {
+        if (!page_) return;
+        std::uint32_t pid = page_->page_id;
+        page_->latch.unlock();
+        page_ = nullptr;
+        buffer_->unpin_page(pid, dirty_);
+        dirty_ = false;
+    }
+
+    explicit operator bool() const { return page_ != nullptr; }
+    // Mutable access marks the page dirty
+    Page& page() { dirty_ = true; return *page_; }
+    char* data() { dirty_ = true; return page_->data.data(); }
+    // Read-only access under the exclusive latch (does not dirty the page)
+    const Page& view() const { return *page_; }
+    std::uint32_t page_id() const { return page_ ? page_->page_id : std::numeric_limits<std::uint32_t>::max(); }
+    bool dirty() const { return dirty_; }
+
+private:
+    BufferManager* buffer_{nullptr};
+    Page* page_{nullptr};
+    bool dirty_{false};
+};
+
+} // namespace pcsql
@@ -1,5 +1,10 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -7,6 +12,9 @@
 
 #include "storage/buffer_manager.hpp"
 #include "storage/disk_manager.hpp"
+#include "storage/free_space_map.hpp"
+#include "storage/mapped_reader.hpp"
+#include "storage/page_guard.hpp"
 #include "storage/table_manager.hpp"
 
 namespace pcsql {
@@ -16,75 +24,244 @@ struct RID {
     std::uint16_t slot_id{0};
 };
 
+class RecordManager;
+
+// Result of RecordManager::vacuum
+struct VacuumStats {
+    std::size_t pages_before{0};
+    std::size_t pages_after{0};
+    std::size_t rows_moved{0};       // rows that got a new RID (index entries repointed by the caller)
+    std::size_t stubs_collapsed{0};  // forwarding stubs removed
+    std::size_t live_rows{0};
+};
+
+// Streaming sequential scan over one table (RecordManager::table_iterator). Only the current
+// page is pinned and share-latched, and next() hands out a view of one live record that stays
+// valid until the following next() / close(). Pages come through a ScanContext like scan().
+// While the iterator holds a page, the same thread must not write to that page: collect the
+// RIDs to change and apply them after close() (or once the iterator is gone).
+// A forwarded row (see RecordManager::update) is returned at its home RID with the bytes of
+// its moved copy; the copy's page stays pinned too until the next advance.
+class TableIterator {
+public:
+    TableIterator() = default;
+    TableIterator(TableIterator&&) noexcept = default;
+    TableIterator& operator=(TableIterator&& o) noexcept; // releases the current page before its ScanContext
+
+    // Advance to the next live record; false (and the iterator closed) at the end of the table
+    bool next();
+    const RID& rid() const { return rid_; }
+    std::string_view record() const { return record_; }
+    // Unpin the current page and stop the scan early
+    void close();
+
+private:
+    friend class RecordManager;
+    TableIterator(RecordManager& records, std::int32_t table_id);
+    // Scan only `pages` (one morsel of a parallel scan) with a scan ring of ring_size frames
+    TableIterator(RecordManager& records, std::int32_t table_id, std::vector<std::uint32_t> pages,
+                  std::size_t ring_size);
+
+    RecordManager* records_{nullptr};
+    std::int32_t table_id_{-1};
+    std::unique_ptr<ScanContext> scan_;
+    std::size_t next_page_{0};             // index into scan_->pages()
+    ReadPageGuard guard_;
+    ReadPageGuard forward_;                // page of the moved copy behind the current stub
+    std::uint16_t slot_{0};
+    std::uint16_t slot_count_{0};
+    RID rid_;
+    std::string_view record_;
+};
+
 class RecordManager {
 public:
     RecordManager(DiskManager& disk, BufferManager& buffer, TableManager& tables)
-        : disk_(disk), buffer_(buffer), tables_(tables) {}
+        : disk_(disk), buffer_(buffer), tables_(tables), fsm_(buffer.page_size()) {}
 
-    // Insert a raw record into table; returns RID
+    // Insert a raw record into table; returns RID. The free space map picks the page, so the
+    // cost does not grow with the table; table metadata is only rewritten when a page is added.
     RID insert(std::int32_t table_id, const char* data, std::size_t size);
     RID insert(std::int32_t table_id, std::string_view bytes) {
         return insert(table_id, bytes.data(), bytes.size());
     }
+    // Bulk load: rows are packed into pages in order with one pin per page, and table metadata is
+    // saved once for the whole batch. Sizes are checked up front, so an oversized row throws
+    // before anything is inserted. Returns the RIDs in row order.
+    std::vector<RID> insert_batch(std::int32_t table_id, const std::string_view* rows, std::size_t count);
+    std::vector<RID> insert_batch(std::int32_t table_id, const std::vector<std::string_view>& rows) {
+        return insert_batch(table_id, rows.data(), rows.size());
+    }
+    std::vector<RID> insert_batch(std::int32_t table_id, const std::vector<std::string>& rows) {
+        std::vector<std::string_view> views(rows.begin(), rows.end());
+        return insert_batch(table_id, views.data(), views.size());
+    }
 
     // Read a record into out (returns false if RID invalid or deleted)
     bool read(const RID& rid, std::string& out);
 
-    // Update record in-place; only succeeds if new size <= original size
+    // Update a record, keeping its RID. A row that no longer fits its page (even after compaction)
+    // moves to another page of the table and leaves a forwarding stub in its home slot, so
+    // RIDs held elsewhere (B+Tree leaves) stay valid. A moved row that outgrows its page moves
+    // again and the stub is repointed: a chain is never longer than one hop. Returns false for an
+    // invalid RID or a row that cannot fit any page.
     bool update(const RID& rid, const char* data, std::size_t size);
     bool update(const RID& rid, std::string_view bytes) { return update(rid, bytes.data(), bytes.size()); }
 
-    // Delete (tombstone) a record; returns false if RID invalid
+    // Delete (tombstone) a record, and its moved copy if it was forwarded; returns false if RID
+    // invalid. Trailing dead slots are trimmed
+    // from the slot directory, and later inserts reuse dead slots, so the RID of a deleted record
+    // may come back for a different record (drop index entries that point to it, see
+    // StorageEngine::update_indexes_on_delete)
     bool erase(const RID& rid);
 
-    // Sequential scan: return all (RID, bytes) in table
+    // Streaming sequential scan (see TableIterator); memory does not grow with the table
+    TableIterator table_iterator(std::int32_t table_id) { return TableIterator(*this, table_id); }
+    // Sequential scan: return all (RID, bytes) in table (copies every row; prefer table_iterator)
     std::vector<std::pair<RID, std::string>> scan(std::int32_t table_id);
 
+    // Morsel-driven parallel scan. The table's page list is cut into morsels of up to morsel_pages
+    // consecutive pages; up to `workers` threads (the caller is one of them) claim morsels in order
+    // and drain each one through its own TableIterator. fn(it, part) runs on a worker thread and
+    // must only write the Part of its morsel, so concatenating the returned parts keeps the order
+    // of a serial scan. Workers are capped at a quarter of the buffer pool and share one scan
+    // ring's worth of frames. The first exception thrown by fn stops the scan and is rethrown.
+    static constexpr std::size_t MORSEL_PAGES = 16;
+    template <class Part, class Fn>
+    std::vector<Part> parallel_scan(std::int32_t table_id, std::size_t workers, Fn&& fn,
+                                    std::size_t morsel_pages = MORSEL_PAGES) {
+        morsel_pages = std::max<std::size_t>(1, morsel_pages);
+        std::vector<std::uint32_t> pages = tables_.get_table_pages(table_id);
+        std::vector<Part> parts((pages.size() + morsel_pages - 1) / morsel_pages);
+        run_morsels(table_id, std::move(pages), morsel_pages, workers,
+                    [&](std::size_t morsel, TableIterator& it) { fn(it, parts[morsel]); });
+        return parts;
+    }
+
+    // Zero-copy scan over a read-only mapping of a snapshot: fn sees each live record as a
+    // view into the mapped page (valid while map lives); no buffer pool frames are used
+    void scan_mapped(const MappedDiskReader& map, std::int32_t table_id,
+                     const std::function<void(const RID&, std::string_view)>& fn) const;
+
+    // VACUUM in place, one page latch at a time. Forwarded rows move back to their home slot when
+    // it has room again (RID kept), otherwise their copy becomes a plain record. Pages at most
+    // half full are emptied into earlier pages of the table that have room (a page is only
+    // emptied when all its rows fit), and empty pages are zeroed, dropped from the page list and
+    // freed to DiskManager; the free space map is rebuilt for the remaining pages. moved(from,
+    // to, row) is called for every row whose RID changed, so the caller can repoint index entries.
+    using MoveFn = std::function<void(const RID& from, const RID& to, std::string_view row)>;
+    VacuumStats vacuum(std::int32_t table_id, const MoveFn& moved);
+
+    // Buffer pool statistics: record pages are tagged Heap, or Catalog for the sys_* tables
+    PageKind page_kind(std::int32_t table_id) const;
+    void tag_pages(std::int32_t table_id);
+
+    // Add an empty page to the table (tagged and known to the free space map); persist = false
+    // leaves saving the table metadata to the caller
+    std::uint32_t allocate_page(std::int32_t table_id, bool persist = true);
+    // Drop the free space map entries of a table that is being dropped
+    void forget_table(std::int32_t table_id) { fsm_.drop_table(table_id); }
+    const FreeSpaceMap& free_space_map() const { return fsm_; }
+
 private:
+    friend class TableIterator;
+
+    void run_morsels(std::int32_t table_id, std::vector<std::uint32_t> pages, std::size_t morsel_pages,
+                     std::size_t workers, const std::function<void(std::size_t, TableIterator&)>& fn);
+
     struct Header { std::uint16_t free_off; std::uint16_t slot_count; };
-    struct Slot { std::int16_t off; std::uint16_t len; }; // off == -1 => deleted
+    // off == DELETED_OFF => deleted. Offsets are unsigned so pages up to 64KB are addressable;
+    // DELETED_OFF keeps the old int16 -1 bit pattern and is never a valid offset.
+    struct Slot { std::uint16_t off; std::uint16_t len; };
+    static constexpr std::uint16_t DELETED_OFF = 0xFFFF;
+    // Top bit of len: the slot takes part in forwarding and its bytes start with a FwdHeader.
+    // FWD_STUB sits in the home slot and names the moved copy; FWD_MOVED prefixes the row's bytes
+    // on the other page and names the home slot (the copy is never addressed by its own RID).
+    static constexpr std::uint16_t REDIRECT = 0x8000;
+    static constexpr std::uint16_t LEN_MASK = 0x7FFF;
+    static constexpr std::uint8_t FWD_STUB = 1;
+    static constexpr std::uint8_t FWD_MOVED = 2;
+    static constexpr std::size_t FWD_HEADER = 1 + sizeof(std::uint32_t) + sizeof(std::uint16_t);
+    static constexpr std::size_t MAX_RECORD = LEN_MASK - FWD_HEADER; // a row must still fit when moved
 
     static Header& header(Page& page) { return *reinterpret_cast<Header*>(page.data.data()); }
     static const Header& header(const Page& page) { return *reinterpret_cast<const Header*>(page.data.data()); }
 
     static Slot* slot_at(Page& page, std::uint16_t idx) {
         auto base = page.data.data();//page.data 是一个存放整个页字节的数组，base 指向页的开头
-        return reinterpret_cast<Slot*>(base + PAGE_SIZE) - (idx + 1);
+        return reinterpret_cast<Slot*>(base + page.data.size()) - (idx + 1);
         //把这个地址转换成 Slot* 类型，得到一个“指向页末的 Slot 指针”。
     }
     static const Slot* slot_at(const Page& page, std::uint16_t idx) {
         auto base = page.data.data();
-        return reinterpret_cast<const Slot*>(base + PAGE_SIZE) - (idx + 1);
+        return reinterpret_cast<const Slot*>(base + page.data.size()) - (idx + 1);
     }
 
     static std::size_t free_space(const Page& page) {
         const auto& h = header(page);
         // Available contiguous space between data region end and slot directory
         std::size_t slots_bytes = static_cast<std::size_t>(h.slot_count) * sizeof(Slot);
-        return PAGE_SIZE - slots_bytes - h.free_off;
+        return page.data.size() - slots_bytes - h.free_off;
     }
 
-    static bool header_valid(const Header& h) {
-        if (h.free_off < sizeof(Header) || h.free_off > PAGE_SIZE) return false;
+    static bool header_valid(const Header& h, std::size_t page_size) {
+        if (h.free_off < sizeof(Header) || h.free_off > page_size) return false;
         std::size_t slots_bytes = static_cast<std::size_t>(h.slot_count) * sizeof(Slot);
-        if (slots_bytes > PAGE_SIZE) return false;
-        if (h.free_off + slots_bytes > PAGE_SIZE) return false;
+        if (slots_bytes > page_size) return false;
+        if (h.free_off + slots_bytes > page_size) return false;
         return true;
     }
 
+    static std::uint16_t slot_len(const Slot* s) { return s->len & LEN_MASK; }
+    static bool slot_live(const Slot* s) { return s->off != DELETED_OFF && slot_len(s) > 0; }
+    static bool slot_redirect(const Slot* s) { return (s->len & REDIRECT) != 0; }
+    static bool slot_in_bounds(const Page& page, const Slot* s) {
+        return s->off >= sizeof(Header) && static_cast<std::size_t>(s->off) + slot_len(s) <= page.data.size();
+    }
+    // Kind (FWD_STUB / FWD_MOVED, 0 if malformed) and the RID stored in a redirect slot's header
+    static std::uint8_t forward_info(const Page& page, const Slot* s, RID& other);
+    static std::string forward_bytes(std::uint8_t kind, const RID& other, const char* data, std::size_t size);
+
     static void ensure_initialized(Page& page) {
         auto& h = header(page);
-        if (!header_valid(h)) {
+        if (!header_valid(h, page.data.size())) {
             h.free_off = static_cast<std::uint16_t>(sizeof(Header));
             h.slot_count = 0;
         }
     }
 
-    static void compact(Page& page);
+    // Initialize the header through the guard only when it is invalid (fresh page), so
+    // pages that already have a valid header are not dirtied
+    static void ensure_initialized(WritePageGuard& guard) {
+        const Page& view = guard.view();
+        if (!header_valid(header(view), view.data.size())) ensure_initialized(guard.page());
+    }
+
+    // Pack live records after the header; trim_slots also drops trailing dead slots (update keeps
+    // them, since it re-fills its own slot right after compacting)
+    static void compact(Page& page, bool trim_slots = true);
+    static void trim_dead_slots(Page& page);
+    static RID place_record(WritePageGuard& guard, const char* data, std::size_t size, std::uint16_t flags = 0);
+    // Rewrite the bytes (and flags) of a live slot within its page, compacting when needed; false
+    // without touching the page when it cannot fit
+    static bool rewrite_slot(WritePageGuard& guard, std::uint16_t slot, const char* data, std::size_t size,
+                             std::uint16_t flags);
+    // Whether size bytes could replace the slot's record once the page is compacted
+    static bool fits_after_compact(const Page& page, std::uint16_t slot, std::size_t size);
+    void check_record_size(std::size_t size) const;
+    RID insert_flagged(std::int32_t table_id, const char* data, std::size_t size, std::uint16_t flags);
+    // Place the record on page_id if it has room; records the page's free space either way
+    std::optional<RID> try_place(std::int32_t table_id, std::uint32_t page_id, const char* data, std::size_t size,
+                                 std::uint16_t flags = 0);
+    // The slot of the moved copy at `copy` if it is live and points back to home, else nullptr
+    static const Slot* moved_copy(const Page& page, const RID& copy, const RID& home);
+    // Tombstone a live slot, trim/compact the page and refresh its free space
+    void tombstone(WritePageGuard& guard, std::uint16_t slot);
 
     DiskManager& disk_;
     BufferManager& buffer_;
     TableManager& tables_;
+    FreeSpaceMap fsm_;
 };
 
 } // namespace pcsql
\ No newline at end of file
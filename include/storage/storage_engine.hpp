@@ -1,16 +1,21 @@
 #pragma once
 #include <cstdint>
+#include <filesystem>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <string>
 #include <sstream>
+#include <thread>
 #include <vector>
 #include <algorithm>
 
 #include "storage/buffer_manager.hpp"
 #include "storage/disk_manager.hpp"
 #include "storage/table_manager.hpp"
+#include "storage/overflow_store.hpp"
 #include "storage/record_manager.hpp"
+#include "storage/tuple.hpp"
 #include "system_catalog/types.hpp"
 #include "storage/bplus_tree.hpp"
 
@@ -18,22 +23,31 @@ namespace pcsql {
 
 class StorageEngine {
 public:
+    // buffer_capacity == 0 sizes the pool from the memory budget (BufferManager::auto_capacity)
     explicit StorageEngine(const std::string& base_dir = ".",
                            std::size_t buffer_capacity = 64,
                            Policy policy = Policy::LRU,
-                           bool log = true)
-        : disk_(base_dir), buffer_(disk_, buffer_capacity, policy, log),
-          tables_(base_dir), records_(disk_, buffer_, tables_) {
+                           bool log = true,
+                           const DiskOptions& disk_options = {})
+        : disk_(base_dir, "data.db", disk_options), buffer_(disk_, buffer_capacity ? buffer_capacity : BufferManager::auto_capacity(disk_.page_size()), policy, log),
+          tables_(base_dir), records_(disk_, buffer_, tables_), overflow_(disk_, buffer_),
+          warmup_path_((std::filesystem::absolute(base_dir) / "buffer.warm").string()) {
         // Bootstrap system catalog tables stored as regular relations
         bootstrapping_ = true;
         ensure_system_catalog();
         bootstrapping_ = false;
+        // 缓冲池统计按页类型/表分类：表页的归属在内存里就有，索引页在 B+ 树访问时登记
+        for (auto tid : tables_.table_ids()) records_.tag_pages(tid);
     }
 
     ~StorageEngine() noexcept {
         try {
+            buffer_.stop_warmup();
+            buffer_.stop_background_writer();
             flush_all();
             std::cout << "[StorageEngine] flushed all dirty pages before exit" << std::endl;
+            // 记录常驻页（按近期性排序），下次启动时 start_warmup 异步预热
+            buffer_.save_warmup(warmup_path_);
         } catch (...) {
             // ignore exceptions during shutdown
         }
@@ -44,15 +58,31 @@ public:
 
     // Disk-level page operations
     std::uint32_t allocate_page() { return disk_.allocate_page(); }
-    void free_page(std::uint32_t pid) { return disk_.free_page(pid); }
+    void free_page(std::uint32_t pid) {
+        buffer_.discard_page(pid);
+        return disk_.free_page(pid);
+    }
 
     // Buffer operations
     Page& get_page(std::uint32_t pid) { return buffer_.get_page(pid); }
     void unpin_page(std::uint32_t pid, bool dirty) { buffer_.unpin_page(pid, dirty); }
     void flush_page(std::uint32_t pid) { buffer_.flush_page(pid); }
-    void flush_all() { buffer_.flush_all(); }
+    void flush_all() { buffer_.flush_all(); disk_.sync(); }
+    // Background writer: trickles dirty, unpinned frames to disk so evictions find clean victims
+    void start_background_writer(const WriterOptions& opts = {}) { buffer_.start_background_writer(opts); }
+    void stop_background_writer() { buffer_.stop_background_writer(); }
+    // Reload the pages that were resident at the last shutdown (base_dir/buffer.warm) in the background
+    void start_warmup() { buffer_.start_warmup(warmup_path_); }
+    void wait_warmup() { buffer_.wait_warmup(); }
+    // Online buffer pool resize (in frames); shrinking evicts the frames above the new size
+    void resize_buffer_pool(std::size_t frames) { buffer_.resize(frames); }
+    std::size_t buffer_pool_capacity() const { return buffer_.capacity(); }
 
-    const Stats& stats() const { return buffer_.stats(); }
+    Stats stats() const { return buffer_.stats(); }
+    // Per page kind / per table counters and the miss latency histogram (SHOW BUFFER STATUS)
+    BufferStatus buffer_status() { return buffer_.status(); }
+    std::size_t page_size() const { return disk_.page_size(); }
+    bool page_allocated(std::uint32_t page_id) { return disk_.is_allocated(page_id); }
 
     // Table operations
     std::int32_t create_table(const std::string& name) { return tables_.create_table(name); }
@@ -69,6 +99,8 @@ public:
     }
     bool drop_table_by_id(std::int32_t tid) {
         auto name = get_table_name(tid);
+        free_table_overflow(tid);
+        forget_table_pages(tid);
         auto ok = tables_.drop_table_by_id(tid, disk_);
         if (ok && !name.empty()) {
             if (!is_system_table(name)) remove_from_sys_catalog(tid);
@@ -76,6 +108,8 @@ public:
         return ok;
     }
     bool drop_table_by_name(const std::string& name) {
+        free_table_overflow(get_table_id(name));
+        forget_table_pages(get_table_id(name));
         auto ok = tables_.drop_table_by_name(name, disk_);
         if (ok) {
             // remove rows if not system table
@@ -89,6 +123,8 @@ public:
     // 在删除表时释放页回收到 DiskManager（提供显式重载）
     bool drop_table_by_id(std::int32_t tid, DiskManager& disk) {
         auto name = get_table_name(tid);
+        free_table_overflow(tid);
+        forget_table_pages(tid);
         auto ok = tables_.drop_table_by_id(tid, disk);
         if (ok && !name.empty()) {
             if (!is_system_table(name)) remove_from_sys_catalog(tid);
@@ -96,6 +132,8 @@ public:
         return ok;
     }
     bool drop_table_by_name(const std::string& name, DiskManager& disk) {
+        free_table_overflow(get_table_id(name));
+        forget_table_pages(get_table_id(name));
         auto ok = tables_.drop_table_by_name(name, disk);
         if (ok) {
             if (!is_system_table(name)) {
@@ -108,16 +146,78 @@ public:
 
     std::int32_t get_table_id(const std::string& name) const { return tables_.get_table_id(name); }
     std::string get_table_name(std::int32_t tid) const { return tables_.get_table_name(tid); }
+    std::vector<std::int32_t> table_ids() const { return tables_.table_ids(); }
     // FIX: call correct TableManager API
-    std::uint32_t allocate_table_page(std::int32_t tid) { return tables_.allocate_table_page(tid, disk_); }
+    std::uint32_t allocate_table_page(std::int32_t tid) {
+        return records_.allocate_page(tid);
+    }
     const std::vector<std::uint32_t>& get_table_pages(std::int32_t tid) const { return tables_.get_table_pages(tid); }
 
     // Record operations
     RID insert_record(std::int32_t table_id, std::string_view data) { return records_.insert(table_id, data); }
+    // Bulk load: rows packed with one pin per page, table metadata saved once, and index entries
+    // inserted per index in key order with the tree opened once (see update_indexes_on_insert)
+    std::vector<RID> insert_batch(std::int32_t table_id, const std::vector<std::string>& rows) {
+        auto rids = records_.insert_batch(table_id, rows);
+        update_indexes_on_insert_batch(table_id, rows, rids);
+        return rids;
+    }
     bool read_record(const RID& rid, std::string& out) { return records_.read(rid, out); }
     bool update_record(const RID& rid, std::string_view data) { return records_.update(rid, data); }
     bool delete_record(const RID& rid) { return records_.erase(rid); }
+    // Streaming scan: one pinned page at a time, record views valid until the next advance
+    TableIterator table_iterator(std::int32_t table_id) { return records_.table_iterator(table_id); }
+    // Materialized scan (copies every row)
     std::vector<std::pair<RID, std::string>> scan_table(std::int32_t table_id) { return records_.scan(table_id); }
+    // Parallel scan over scan_workers() threads (see RecordManager::parallel_scan): fn(it, part)
+    // drains one morsel; the parts come back in page order
+    template <class Part, class Fn>
+    std::vector<Part> parallel_scan(std::int32_t table_id, Fn&& fn) {
+        return records_.parallel_scan<Part>(table_id, scan_workers_, std::forward<Fn>(fn));
+    }
+    // VACUUM (see RecordManager::vacuum): collapse forwarding stubs, merge sparse pages into
+    // earlier ones and free empty pages, so later scans pin fewer pages. Index entries of rows
+    // that moved are repointed; overflow chains stay where they are.
+    VacuumStats vacuum_table(std::int32_t tid) {
+        // 索引列表、schema 与布局只查一次，逐行回调里不再扫系统表
+        auto idxs = get_table_indexes(tid);
+        const TableSchema schema = idxs.empty() ? TableSchema{} : get_table_schema(get_table_name(tid));
+        const TupleLayout layout(schema);
+        auto stats = records_.vacuum(tid, [&](const RID& from, const RID& to, std::string_view row) {
+            if (idxs.empty()) return;
+            std::string bytes(row);
+            unindex_row(tid, idxs, schema, layout, bytes, from);
+            index_row(tid, idxs, schema, layout, bytes, to);
+        });
+        dead_rows_[tid] = 0;
+        vacuum_live_rows_[tid] = stats.live_rows;
+        return stats;
+    }
+    // Autovacuum: DELETE/UPDATE report how many rows they removed or rewrote, and autovacuum()
+    // vacuums every table with more than AUTOVACUUM_BASE + AUTOVACUUM_SCALE * (live rows at its
+    // last vacuum) such rows. Call it between statements (pcsqld does so on its idle tick).
+    static constexpr std::size_t AUTOVACUUM_BASE = 50;
+    static constexpr double AUTOVACUUM_SCALE = 0.2;
+    void note_dead_rows(std::int32_t tid, std::size_t n) { if (n) dead_rows_[tid] += n; }
+    std::size_t dead_rows(std::int32_t tid) const {
+        auto it = dead_rows_.find(tid);
+        return it == dead_rows_.end() ? 0 : it->second;
+    }
+    std::vector<std::pair<std::int32_t, VacuumStats>> autovacuum() {
+        std::vector<std::pair<std::int32_t, VacuumStats>> done;
+        std::vector<std::int32_t> due;
+        for (const auto& [tid, dead] : dead_rows_) {
+            auto live = vacuum_live_rows_.find(tid);
+            double threshold = AUTOVACUUM_BASE + AUTOVACUUM_SCALE * (live == vacuum_live_rows_.end() ? 0 : live->second);
+            if (dead > threshold && !get_table_name(tid).empty()) due.push_back(tid);
+        }
+        for (auto tid : due) done.emplace_back(tid, vacuum_table(tid));
+        return done;
+    }
+
+    // Worker threads for parallel scans (full-scan SELECT, index builds); 1 scans serially
+    void set_scan_workers(std::size_t n) { scan_workers_ = std::max<std::size_t>(1, n); }
+    std::size_t scan_workers() const { return scan_workers_; }
 
     // Schema query from system tables (single source of truth)
     TableSchema get_table_schema(const std::string& table_name) {
@@ -126,11 +226,9 @@ public:
         if (tid < 0) return schema;
         int sys_cid = tables_.get_table_id("sys_columns");
         if (sys_cid < 0) return schema;
-        auto rows = records_.scan(sys_cid);
         std::vector<std::pair<int, ColumnMetadata>> cols;
-        cols.reserve(rows.size());
-        for (const auto& kv : rows) {
-            const std::string& row = kv.second;
+        for (auto it = records_.table_iterator(sys_cid); it.next();) {
+            std::string row(it.record());
             // format (new): table_id|col_index|name|type|length|constraints
             // format (legacy): table_id|col_index|name|type|constraints
             std::vector<std::string> fields; fields.reserve(6);
@@ -172,6 +270,34 @@ public:
         return schema;
     }
 
+    // Row layout of a user table (empty for tables without a schema, whose rows stay raw bytes)
+    TupleLayout table_layout(const std::string& table_name) { return TupleLayout(get_table_schema(table_name)); }
+
+    // -------- Out-of-line values --------
+    // Rows are encoded with large VARCHAR values on overflow pages once they exceed a quarter
+    // page, so heap pages stay dense for scans that do not read those columns. Readers pass
+    // &overflow_store() to TupleView; the pages are only read when such a column is accessed.
+    const OverflowStore& overflow_store() const { return overflow_; }
+    std::size_t overflow_threshold() const { return buffer_.page_size() / 4; }
+    std::string encode_row(std::int32_t table_id, const TupleLayout& layout, const std::vector<std::string>& values) {
+        return encode_tuple(layout, values, overflow_, table_id, overflow_threshold());
+    }
+    // UPDATE: columns with a ref in kept keep their existing overflow chain (see encode_tuple)
+    std::string encode_row(std::int32_t table_id, const TupleLayout& layout, const std::vector<std::string>& values,
+                           const std::vector<std::optional<OverflowRef>>& kept) {
+        return encode_tuple(layout, values, kept, overflow_, table_id, overflow_threshold());
+    }
+    // Free the overflow chains of a row that was deleted or replaced; columns with a ref in kept
+    // share their chain with the other version of the row and are left alone
+    void free_overflow(const TupleLayout& layout, std::string_view row,
+                       const std::vector<std::optional<OverflowRef>>& kept = {}) {
+        TupleView view(layout, row);
+        for (std::size_t i = 0; i < layout.columns(); ++i) {
+            if (i < kept.size() && kept[i]) continue;
+            if (auto ref = view.external_ref(i)) overflow_.free(*ref);
+        }
+    }
+
     // -------- Index management (B+Tree over INT keys; UNIQUE only for now) --------
     struct IndexInfo {
         std::string name;
@@ -200,6 +326,7 @@ public:
             }
         }
         if (col_idx < 0) throw std::runtime_error("Column not found: " + column_name);
+        TupleLayout layout(schema);
         // Build B+Tree depending on column type
         std::uint32_t root = 0;
         std::cout << "[StorageEngine] Building index '" << index_name << "' on "
@@ -208,43 +335,47 @@ public:
                   << std::endl;
         if (dtype == DataType::INT) {
             BPlusTree tree(disk_, buffer_);
+            tree.set_owner(tid);
             tree.set_trace(index_trace_);
             root = tree.create();
-            // insert existing rows
-            auto rows = scan_table(tid);
-            for (const auto& kv : rows) {
-                const RID& rid = kv.first;
-                const std::string& row = kv.second;
-                // split row by '|'
-                std::vector<std::string> fields; std::string cur; std::istringstream iss(row);
-                while (std::getline(iss, cur, '|')) fields.push_back(cur);
-                if (col_idx >= static_cast<int>(fields.size()))
-                    throw std::runtime_error("Row parse error when building index");
-                long long key_ll = 0; try { key_ll = std::stoll(fields[col_idx]); } catch (...) { throw std::runtime_error("Non-integer value encountered while building index"); }
-                if (!tree.insert(static_cast<std::int64_t>(key_ll), rid)) {
-                    throw std::runtime_error("Duplicate key detected when building UNIQUE index");
+            // insert existing rows (NULL keys are not indexed); keys are extracted by a parallel
+            // scan and inserted here in page order
+            auto parts = parallel_scan<std::vector<std::pair<std::int64_t, RID>>>(tid, [&](TableIterator& it, auto& keys) {
+                while (it.next()) {
+                    TupleView row(layout, it.record(), &overflow_);
+                    if (!row.is_null(col_idx)) keys.emplace_back(row.get_int(col_idx), it.rid());
+                }
+            });
+            for (const auto& keys : parts) {
+                for (const auto& [key, rid] : keys) {
+                    if (!tree.insert(key, rid)) {
+                        throw std::runtime_error("Duplicate key detected when building UNIQUE index");
+                    }
                 }
             }
+            root = tree.root(); // 根可能在插入中分裂
         } else if (dtype == DataType::VARCHAR) {
             // Use fixed-size key for VARCHAR index
             using StrKey = FixedString<128>;
             BPlusTreeT<StrKey> tree(disk_, buffer_);
+            tree.set_owner(tid);
             tree.set_trace(index_trace_);
             root = tree.create();
-            // insert existing rows
-            auto rows = scan_table(tid);
-            for (const auto& kv : rows) {
-                const RID& rid = kv.first;
-                const std::string& row = kv.second;
-                std::vector<std::string> fields; std::string cur; std::istringstream iss(row);
-                while (std::getline(iss, cur, '|')) fields.push_back(cur);
-                if (col_idx >= static_cast<int>(fields.size()))
-                    throw std::runtime_error("Row parse error when building index");
-                StrKey key(fields[col_idx]);
-                if (!tree.insert(key, rid)) {
-                    throw std::runtime_error("Duplicate key detected when building UNIQUE index");
+            // insert existing rows (extracted in parallel, inserted in page order)
+            auto parts = parallel_scan<std::vector<std::pair<std::string, RID>>>(tid, [&](TableIterator& it, auto& keys) {
+                while (it.next()) {
+                    TupleView row(layout, it.record(), &overflow_);
+                    if (!row.is_null(col_idx)) keys.emplace_back(row.get_varchar(col_idx), it.rid());
+                }
+            });
+            for (const auto& keys : parts) {
+                for (const auto& [value, rid] : keys) {
+                    if (!tree.insert(StrKey{value}, rid)) {
+                        throw std::runtime_error("Duplicate key detected when building UNIQUE index");
+                    }
                 }
             }
+            root = tree.root();
         } else {
             throw std::runtime_error("Only INT/VARCHAR column is supported for index currently");
         }
@@ -258,9 +389,8 @@ public:
         std::vector<IndexInfo> out;
         int sys_i = tables_.get_table_id("sys_indexes");
         if (sys_i < 0) return out;
-        auto rows = records_.scan(sys_i);
-        for (const auto& kv : rows) {
-            const std::string& row = kv.second;
+        for (auto it = records_.table_iterator(sys_i); it.next();) {
+            std::string row(it.record());
             // index_name|table_id|column|unique|root
             std::vector<std::string> f; std::string cur; std::istringstream iss(row);
             while (std::getline(iss, cur, '|')) f.push_back(cur);
@@ -287,36 +417,43 @@ public:
     void update_indexes_on_insert(int table_id, const std::string& row, const RID& rid) {
         auto idxs = get_table_indexes(table_id);
         if (idxs.empty()) return;
-        // parse row once
-        std::vector<std::string> fields; std::string cur; std::istringstream iss(row);
-        while (std::getline(iss, cur, '|')) fields.push_back(cur);
         // get schema once for types
         auto schema = get_table_schema(get_table_name(table_id));
-        for (const auto& idx : idxs) {
-            if (idx.column_index < 0 || idx.column_index >= static_cast<int>(fields.size())) continue;
-            DataType dtype = DataType::UNKNOWN;
-            if (idx.column_index < static_cast<int>(schema.columns.size())) {
-                dtype = schema.columns[idx.column_index].type;
-            }
+        TupleLayout layout(schema);
+        index_row(table_id, idxs, schema, layout, row, rid);
+    }
+    // Same with the index list, schema and layout already looked up (callers touching many rows
+    // fetch them once); a root that moves is written back to idxs as well as sys_indexes
+    void index_row(int table_id, std::vector<IndexInfo>& idxs, const TableSchema& schema,
+                   const TupleLayout& layout, std::string_view row, const RID& rid) {
+        TupleView view(layout, row, &overflow_);
+        for (auto& idx : idxs) {
+            if (idx.column_index < 0 || idx.column_index >= static_cast<int>(schema.columns.size())) continue;
+            if (view.is_null(idx.column_index)) continue; // NULL keys are not indexed
+            DataType dtype = schema.columns[idx.column_index].type;
             if (dtype == DataType::INT) {
-                long long key_ll = 0; try { key_ll = std::stoll(fields[idx.column_index]); } catch (...) { continue; }
+                std::int64_t key = view.get_int(idx.column_index);
                 BPlusTree tree(disk_, buffer_);
+                tree.set_owner(table_id);
                 tree.open(idx.root);
                 tree.set_trace(index_trace_);
-                bool ok = tree.insert(static_cast<std::int64_t>(key_ll), rid);
+                bool ok = tree.insert(key, rid);
                 if (!ok && idx.unique) {
-                    std::cerr << "[StorageEngine] UNIQUE index violation on '" << idx.name << "' for key=" << key_ll << std::endl;
+                    std::cerr << "[StorageEngine] UNIQUE index violation on '" << idx.name << "' for key=" << key << std::endl;
                 }
+                if (tree.root() != idx.root) { update_index_root(idx, tree.root()); idx.root = tree.root(); }
             } else if (dtype == DataType::VARCHAR) {
                 using StrKey = FixedString<128>;
                 BPlusTreeT<StrKey> tree(disk_, buffer_);
+                tree.set_owner(table_id);
                 tree.open(idx.root);
                 tree.set_trace(index_trace_);
-                StrKey key(fields[idx.column_index]);
-                bool ok = tree.insert(key, rid);
+                std::string text(view.get_varchar(idx.column_index));
+                bool ok = tree.insert(StrKey(text), rid);
                 if (!ok && idx.unique) {
-                    std::cerr << "[StorageEngine] UNIQUE index violation on '" << idx.name << "' for key='" << fields[idx.column_index] << "'" << std::endl;
+                    std::cerr << "[StorageEngine] UNIQUE index violation on '" << idx.name << "' for key='" << text << "'" << std::endl;
                 }
+                if (tree.root() != idx.root) { update_index_root(idx, tree.root()); idx.root = tree.root(); }
             } else {
                 // other types not supported yet
                 continue;
@@ -324,6 +461,97 @@ public:
         }
     }
 
+    // After deleting a row, drop its index entries (only entries that still point to rid, so a
+    // key that a UNIQUE violation left pointing at another row is kept). Needed because the
+    // deleted slot, and with it the RID, is reused by later inserts.
+    void update_indexes_on_delete(int table_id, const std::string& row, const RID& rid) {
+        auto idxs = get_table_indexes(table_id);
+        if (idxs.empty()) return;
+        auto schema = get_table_schema(get_table_name(table_id));
+        TupleLayout layout(schema);
+        unindex_row(table_id, idxs, schema, layout, row, rid);
+    }
+    void unindex_row(int table_id, const std::vector<IndexInfo>& idxs, const TableSchema& schema,
+                     const TupleLayout& layout, std::string_view row, const RID& rid) {
+        TupleView view(layout, row, &overflow_);
+        auto same = [&](const RID& r) { return r.page_id == rid.page_id && r.slot_id == rid.slot_id; };
+        for (const auto& idx : idxs) {
+            if (idx.column_index < 0 || idx.column_index >= static_cast<int>(schema.columns.size())) continue;
+            if (view.is_null(idx.column_index)) continue;
+            DataType dtype = schema.columns[idx.column_index].type;
+            if (dtype == DataType::INT) {
+                std::int64_t key = view.get_int(idx.column_index);
+                BPlusTree tree(disk_, buffer_);
+                tree.set_owner(table_id);
+                tree.open(idx.root);
+                tree.set_trace(index_trace_);
+                RID got;
+                if (tree.search(key, got) && same(got)) tree.erase(key);
+            } else if (dtype == DataType::VARCHAR) {
+                using StrKey = FixedString<128>;
+                BPlusTreeT<StrKey> tree(disk_, buffer_);
+                tree.set_owner(table_id);
+                tree.open(idx.root);
+                tree.set_trace(index_trace_);
+                StrKey key{std::string(view.get_varchar(idx.column_index))};
+                RID got;
+                if (tree.search(key, got) && same(got)) tree.erase(key);
+            }
+        }
+    }
+
+    // Same for a batch of rows (rows[i] stored at rids[i]): index metadata and schema are looked
+    // up once, and each index gets its entries sorted by key so the descent stays on hot pages
+    void update_indexes_on_insert_batch(int table_id, const std::vector<std::string>& rows, const std::vector<RID>& rids) {
+        auto idxs = get_table_indexes(table_id);
+        if (idxs.empty()) return;
+        auto schema = get_table_schema(get_table_name(table_id));
+        TupleLayout layout(schema);
+        for (const auto& idx : idxs) {
+            if (idx.column_index < 0 || idx.column_index >= static_cast<int>(schema.columns.size())) continue;
+            DataType dtype = schema.columns[idx.column_index].type;
+            if (dtype == DataType::INT) {
+                std::vector<std::pair<std::int64_t, RID>> entries;
+                entries.reserve(rows.size());
+                for (std::size_t i = 0; i < rows.size(); ++i) {
+                    TupleView view(layout, rows[i], &overflow_);
+                    if (!view.is_null(idx.column_index)) entries.emplace_back(view.get_int(idx.column_index), rids[i]);
+                }
+                std::stable_sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+                BPlusTree tree(disk_, buffer_);
+                tree.set_owner(table_id);
+                tree.open(idx.root);
+                tree.set_trace(index_trace_);
+                for (const auto& [key, rid] : entries) {
+                    if (!tree.insert(key, rid) && idx.unique) {
+                        std::cerr << "[StorageEngine] UNIQUE index violation on '" << idx.name << "' for key=" << key << std::endl;
+                    }
+                }
+                if (tree.root() != idx.root) update_index_root(idx, tree.root());
+            } else if (dtype == DataType::VARCHAR) {
+                using StrKey = FixedString<128>;
+                // copies: an out-of-line value only lives as long as its view
+                std::vector<std::pair<std::string, RID>> entries;
+                entries.reserve(rows.size());
+                for (std::size_t i = 0; i < rows.size(); ++i) {
+                    TupleView view(layout, rows[i], &overflow_);
+                    if (!view.is_null(idx.column_index)) entries.emplace_back(std::string(view.get_varchar(idx.column_index)), rids[i]);
+                }
+                std::stable_sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+                BPlusTreeT<StrKey> tree(disk_, buffer_);
+                tree.set_owner(table_id);
+                tree.open(idx.root);
+                tree.set_trace(index_trace_);
+                for (const auto& [key, rid] : entries) {
+                    if (!tree.insert(StrKey(key), rid) && idx.unique) {
+                        std::cerr << "[StorageEngine] UNIQUE index violation on '" << idx.name << "' for key='" << key << "'" << std::endl;
+                    }
+                }
+                if (tree.root() != idx.root) update_index_root(idx, tree.root());
+            }
+        }
+    }
+
     // Index-assisted selection (INT-only). Returns matching rows via RID lookup.
     std::vector<std::pair<RID, std::string>> index_select_eq_int(int table_id, int column_index, long long key) {
         std::vector<std::pair<RID, std::string>> out;
@@ -335,6 +563,7 @@ public:
             std::cout << "[StorageEngine] Index search EQ on table_id=" << table_id << ", column_index=" << column_index << ", key=" << key << std::endl;
         }
         BPlusTree tree(disk_, buffer_);
+        tree.set_owner(table_id);
         tree.open(found->root);
         tree.set_trace(index_trace_);
         RID rid; if (tree.search(static_cast<std::int64_t>(key), rid)) {
@@ -355,6 +584,7 @@ public:
                       << ", range=[" << low << ", " << high << "]" << std::endl;
         }
         BPlusTree tree(disk_, buffer_);
+        tree.set_owner(table_id);
         tree.open(found->root);
         tree.set_trace(index_trace_);
         auto kvs = tree.range(static_cast<std::int64_t>(low), static_cast<std::int64_t>(high));
@@ -378,6 +608,7 @@ public:
         }
         using StrKey = FixedString<128>;
         BPlusTreeT<StrKey> tree(disk_, buffer_);
+        tree.set_owner(table_id);
         tree.open(found->root);
         tree.set_trace(index_trace_);
         RID rid; if (tree.search(StrKey(key), rid)) {
@@ -401,6 +632,7 @@ public:
         }
         using StrKey = FixedString<128>;
         BPlusTreeT<StrKey> tree(disk_, buffer_);
+        tree.set_owner(table_id);
         tree.open(found->root);
         tree.set_trace(index_trace_);
         auto kvs = tree.range(StrKey(low), StrKey(high));
@@ -438,6 +670,27 @@ private:
     static inline std::vector<std::string> split(const std::string& s, char delim) {
         std::vector<std::string> out; std::string cur; std::istringstream iss(s); while (std::getline(iss, cur, delim)) out.push_back(cur); return out;
     }
+    // Before a drop: free the overflow chains the table's rows point to (not in its page list)
+    void free_table_overflow(std::int32_t tid) {
+        std::string name = get_table_name(tid);
+        if (tid < 0 || name.empty() || is_system_table(name)) return;
+        TupleLayout layout = table_layout(name);
+        std::vector<OverflowRef> refs;
+        for (auto it = table_iterator(tid); it.next();) {
+            TupleView row(layout, it.record());
+            for (std::size_t i = 0; i < layout.columns(); ++i) {
+                if (auto ref = row.external_ref(i)) refs.push_back(*ref);
+            }
+        }
+        for (const auto& ref : refs) overflow_.free(ref);
+    }
+    // 表被删除前：清掉缓冲池里的页（内容与标签，页号被复用时不会读到已删表的行）和空闲空间映射里的页
+    void forget_table_pages(std::int32_t tid) {
+        for (auto pid : tables_.get_table_pages(tid)) buffer_.discard_page(pid);
+        records_.forget_table(tid);
+        dead_rows_.erase(tid);
+        vacuum_live_rows_.erase(tid);
+    }
     void ensure_system_catalog() {
         // Create system tables if not exist
         if (tables_.get_table_id("sys_tables") < 0) {
@@ -479,6 +732,7 @@ private:
             if (id < 0) return;
             auto rows = records_.scan(id);
             // naive: drop and recreate table entries without deleted rows
+            forget_table_pages(id);
             tables_.drop_table_by_id(id, disk_);
             tables_.create_table(sys_table);
             int nid = tables_.get_table_id(sys_table);
@@ -501,6 +755,24 @@ private:
         filter_out("sys_columns");
         filter_out("sys_indexes");
     }
+    // A root split moves the tree's root: record it in sys_indexes, or the next lookup would
+    // descend from the old root (now the left child) and miss the right half
+    void update_index_root(const IndexInfo& idx, std::uint32_t root) {
+        int sys_i = tables_.get_table_id("sys_indexes");
+        if (sys_i < 0) return;
+        RID rid;
+        bool found = false;
+        for (auto it = records_.table_iterator(sys_i); !found && it.next();) {
+            auto f = split(std::string(it.record()), '|');
+            if (f.size() >= 5 && f[0] == idx.name && f[1] == std::to_string(idx.table_id)) {
+                rid = it.rid();
+                found = true;
+            }
+        }
+        if (!found) return;
+        records_.erase(rid);
+        insert_into_sys_indexes(idx.name, idx.table_id, idx.column, idx.unique, root);
+    }
     void insert_into_sys_indexes(const std::string& index_name,
                                  int table_id,
                                  const std::string& column,
@@ -518,8 +790,13 @@ private:
     BufferManager buffer_;
     TableManager tables_;
     RecordManager records_;
+    OverflowStore overflow_;
+    std::string warmup_path_;
     bool bootstrapping_ = false;
     bool index_trace_ = false; // forward tracing to B+Tree operations
+    std::size_t scan_workers_ = std::max(1u, std::thread::hardware_concurrency());
+    std::map<std::int32_t, std::size_t> dead_rows_;        // table -> rows deleted/rewritten since its last vacuum
+    std::map<std::int32_t, std::size_t> vacuum_live_rows_; // table -> live rows counted by its last vacuum
 };
 
 } // namespace pcsql
\ No newline at end of file
@@ -29,10 +29,16 @@ public:
     // Lookup
     std::int32_t get_table_id(const std::string& name) const;
     std::string get_table_name(std::int32_t table_id) const;
+    std::vector<std::int32_t> table_ids() const;
 
     // Page mapping ops
-    std::uint32_t allocate_table_page(std::int32_t table_id, DiskManager& disk);
+    // persist = false skips save(), for callers that add several pages and save once
+    std::uint32_t allocate_table_page(std::int32_t table_id, DiskManager& disk, bool persist = true);
     const std::vector<std::uint32_t>& get_table_pages(std::int32_t table_id) const;
+    // Remove pages from the table's page list (saved first), then free them in DiskManager
+    void release_table_pages(std::int32_t table_id, const std::vector<std::uint32_t>& pages, DiskManager& disk);
+    // Table that owns page_id, or -1 (linear in the number of pages; for rare paths only)
+    std::int32_t page_owner(std::uint32_t page_id) const;
 
     // Persistence
     void load();
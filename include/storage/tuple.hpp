@@ -0,0 +1,131 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "storage/overflow_store.hpp"
+#include "system_catalog/types.hpp"
+
+namespace pcsql {
+
+// Binary row format of tables that have a schema (the sys_* catalog tables and schema-less
+// storage tables keep their raw bytes):
+//   [u8 TUPLE_TAG][u16 column count][null bitmap, (n + 7) / 8 bytes][fixed slots][var data]
+// Fixed slots follow column order: INT and TIMESTAMP are int64 (TIMESTAMP = seconds of the civil
+// date-time since 1970-01-01 00:00:00, no time zone), DOUBLE a double, BOOLEAN one byte, VARCHAR
+// (and UNKNOWN) a u16 offset from the tuple start + u16 length into the var data. Column i sits
+// at a position fixed by the schema, so reading it does not parse the columns before it.
+// A VARCHAR whose length has TUPLE_EXTERNAL set is stored out of line: its var data is an
+// OverflowRef {u32 first page, u32 length} into an OverflowStore chain.
+// Rows written before this format ('|'-joined text) carry no tag; TupleView still reads them.
+constexpr std::uint8_t TUPLE_TAG = 0xB1;
+constexpr std::uint16_t TUPLE_EXTERNAL = 0x8000;
+// VARCHAR values up to this many bytes always stay in the row
+constexpr std::size_t TUPLE_MIN_EXTERNAL = 64;
+
+class TupleLayout {
+public:
+    TupleLayout() = default;
+    explicit TupleLayout(std::vector<DataType> types);
+    explicit TupleLayout(const TableSchema& schema);
+
+    std::size_t columns() const { return types_.size(); }
+    bool empty() const { return types_.empty(); }
+    DataType type(std::size_t i) const { return types_[i]; }
+    std::size_t offset(std::size_t i) const { return offsets_[i]; } // fixed slot of column i
+    std::size_t fixed_size() const { return fixed_size_; }         // tag + count + bitmap + slots
+
+    static std::size_t slot_width(DataType type);
+
+private:
+    std::vector<DataType> types_;
+    std::vector<std::size_t> offsets_;
+    std::size_t fixed_size_{0};
+};
+
+// Encode SQL literal texts into a tuple. "NULL" (any case) is NULL for every type, and so is ""
+// for non-VARCHAR columns; missing trailing values are NULL. Throws std::invalid_argument when a
+// value does not parse for its column type, there are more values than columns, or the row does
+// not fit the u16 offsets (an in-row VARCHAR is at most 32767 bytes).
+std::string encode_tuple(const TupleLayout& layout, const std::vector<std::string>& values);
+// Same, but VARCHAR values move to overflow pages, largest first, while the row is larger than
+// threshold bytes. Values are validated before any overflow page is written.
+std::string encode_tuple(const TupleLayout& layout, const std::vector<std::string>& values,
+                         OverflowStore& overflow, std::int32_t table_id, std::size_t threshold);
+// Same, but a column with a ref in kept (UPDATE leaving it unassigned) keeps that out-of-line
+// value as is: its chain is neither read nor rewritten, and its entry in values must be non-NULL
+// text (it is otherwise ignored). Only the other columns may get new overflow chains.
+std::string encode_tuple(const TupleLayout& layout, const std::vector<std::string>& values,
+                         const std::vector<std::optional<OverflowRef>>& kept,
+                         OverflowStore& overflow, std::int32_t table_id, std::size_t threshold);
+
+// Read-only accessor over one stored row: O(1) per column and no allocation except in text().
+// Legacy text rows are read by scanning the text for the field. The bytes must outlive the view.
+// An out-of-line VARCHAR is fetched from `overflow` only when that column is read, and kept for
+// the life of the view; reading one without an OverflowStore throws std::logic_error.
+class TupleView {
+public:
+    TupleView(const TupleLayout& layout, std::string_view bytes, const OverflowStore* overflow = nullptr);
+
+    const TupleLayout& layout() const { return *layout_; }
+    bool legacy() const { return legacy_; }
+
+    bool is_null(std::size_t i) const;
+    std::int64_t get_int(std::size_t i) const;         // INT / TIMESTAMP; 0 when NULL
+    double get_double(std::size_t i) const;            // 0 when NULL
+    bool get_bool(std::size_t i) const;                // false when NULL
+    std::string_view get_varchar(std::size_t i) const; // VARCHAR / UNKNOWN; empty when NULL
+    // Out-of-line VARCHAR: its reference, without reading the overflow pages
+    std::optional<OverflowRef> external_ref(std::size_t i) const;
+
+    // Column i in SQL literal form ("NULL" for NULL)
+    std::string text(std::size_t i) const;
+    std::vector<std::string> texts() const;
+    // All columns joined with '|' (the old stored form, used for display)
+    std::string to_text() const;
+
+private:
+    std::string_view legacy_field(std::size_t i) const;
+
+    const TupleLayout* layout_;
+    std::string_view bytes_;
+    bool legacy_;
+    const OverflowStore* overflow_;
+    mutable std::map<std::size_t, std::string> fetched_; // column -> out-of-line value already read
+};
+
+// `column op literal` over tuples: the literal is parsed once for the column type and each row
+// is compared in place. NULL fields never match. A literal that does not parse for a numeric or
+// TIMESTAMP column falls back to comparing the field's text, as the text format did.
+class TuplePredicate {
+public:
+    // op is one of = != < > <= >=; nullopt for another op or a column outside the layout
+    static std::optional<TuplePredicate> make(const TupleLayout& layout, std::size_t column,
+                                              const std::string& op, std::string literal);
+
+    bool matches(const TupleView& row) const;
+    std::size_t column() const { return column_; }
+
+private:
+    enum class Op { EQ, NE, LT, GT, LE, GE };
+    bool holds(int c) const;
+
+    std::size_t column_{0};
+    Op op_{Op::EQ};
+    DataType type_{DataType::UNKNOWN};
+    bool text_mode_{false};
+    std::int64_t int_{0};
+    double double_{0};
+    bool bool_{false};
+    std::string text_;
+};
+
+// "YYYY-MM-DD HH:MM:SS" (or "YYYY-MM-DD") <-> seconds since 1970-01-01 00:00:00
+std::optional<std::int64_t> parse_timestamp(std::string_view text);
+std::string format_timestamp(std::int64_t seconds);
+
+} // namespace pcsql
@@ -21,7 +21,7 @@ std::unique_ptr<PlanNode> ExecutionPlanGenerator::generate(const std::vector<Qua
     int idx = -1;
     std::string root;
     // Priority: single-statement IR contains exactly one of these root ops
-    const char* roots[] = {"CREATE_TABLE","CREATE_INDEX","INSERT_INTO","SELECT_FROM","UPDATE","DELETE_FROM","DROP_TABLE"};
+    const char* roots[] = {"CREATE_TABLE","CREATE_INDEX","INSERT_INTO","SELECT_FROM","UPDATE","DELETE_FROM","DROP_TABLE","VACUUM"};
     for (const char* r : roots) {
         int t = find_op(r);
         if (t >= 0) { idx = t; root = r; break; }
@@ -107,6 +107,8 @@ std::unique_ptr<PlanNode> ExecutionPlanGenerator::generate(const std::vector<Qua
     } else if (root == "DROP_TABLE") {
         bool if_exists = (firstQuad.result == "1");
         return std::make_unique<DropTablePlanNode>(firstQuad.arg1, if_exists);
+    } else if (root == "VACUUM") {
+        return std::make_unique<VacuumPlanNode>(firstQuad.arg1 == "NULL" ? std::string() : firstQuad.arg1);
     }
 
     throw std::runtime_error(std::string("[执行计划, (line 0, column 0), Unsupported IR operation '") + firstQuad.op + "']");
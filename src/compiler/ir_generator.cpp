@@ -21,6 +21,8 @@ std::vector<Quadruplet> IRGenerator::generate(const std::unique_ptr<ASTNode>& as
         visit(updateStmt);
     } else if (auto dropTableStmt = dynamic_cast<DropTableStatement*>(ast.get())) {
         visit(dropTableStmt);
+    } else if (auto vacuumStmt = dynamic_cast<VacuumStatement*>(ast.get())) {
+        visit(vacuumStmt);
     }
     
     return quadruplets_;
@@ -111,4 +113,9 @@ void IRGenerator::visit(CreateIndexStatement* node) {
 void IRGenerator::visit(DropTableStatement* node) {
     // 为 DROP TABLE 生成简洁 IR：第一项操作符为 DROP_TABLE，arg1=表名，result=IF EXISTS 标志
     quadruplets_.push_back({"DROP_TABLE", node->tableName, "NULL", node->ifExists ? "1" : "0"});
-}
\ No newline at end of file
+}
+
+void IRGenerator::visit(VacuumStatement* node) {
+    // VACUUM：arg1=表名（空表名记为 NULL，表示所有用户表）
+    quadruplets_.push_back({"VACUUM", node->tableName.empty() ? "NULL" : node->tableName, "NULL", "NULL"});
+}
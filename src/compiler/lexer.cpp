@@ -16,7 +16,8 @@ const std::unordered_set<std::string> Lexer::keywords_ = {
     "INT", "DOUBLE", "VARCHAR", "CHAR",
     "TIMESTAMP", "AUTO_INCREMENT", "CURRENT_TIMESTAMP",
     // 新增：DROP / IF / EXISTS 支持
-    "DROP", "IF", "EXISTS"
+    "DROP", "IF", "EXISTS",
+    "VACUUM"
 };
 
 // 2. 构造函数
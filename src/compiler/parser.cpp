@@ -90,6 +90,11 @@ namespace {
             std::cout << indent(level+1) << "ifExists: " << (drop->ifExists ? "true" : "false") << std::endl;
             return;
         }
+        if (auto vac = dynamic_cast<const VacuumStatement*>(node)) {
+            std::cout << indent(level) << "VacuumStatement" << std::endl;
+            std::cout << indent(level+1) << "table: " << (vac->tableName.empty() ? "<all>" : vac->tableName) << std::endl;
+            return;
+        }
         std::cout << indent(level) << "<Unknown ASTNode type>" << std::endl;
     }
 }
@@ -202,6 +207,8 @@ std::unique_ptr<ASTNode> Parser::parse() {
         } else {
             reportError("Unsupported DROP statement type");
         }
+    } else if (currentToken().value == "VACUUM") {
+        ast = parseVacuumStatement();
     } else {
         reportError("Unsupported SQL statement");
     }
@@ -614,4 +621,17 @@ std::unique_ptr<ASTNode> Parser::parseDropTableStatement() {
     eat(";");
 
     return node;
-}
\ No newline at end of file
+}
+
+std::unique_ptr<ASTNode> Parser::parseVacuumStatement() {
+    std::cout << "Parsing VACUUM statement..." << std::endl;
+    auto node = std::make_unique<VacuumStatement>();
+    eat("VACUUM");
+    // 可选表名；省略时清理所有用户表（末尾分号由 parse 统一处理）
+    if (currentToken().type == TokenType::IDENTIFIER) {
+        node->tableTokenIndex = pos_;
+        node->tableName = currentToken().value;
+        eat(TokenType::IDENTIFIER);
+    }
+    return node;
+}
@@ -51,6 +51,8 @@ void SemanticAnalyzer::analyze(const std::unique_ptr<ASTNode>& ast, const std::v
             visit(createIndexStmt, tokens);
         } else if (auto dropTableStmt = dynamic_cast<DropTableStatement*>(ast.get())) {
             visit(dropTableStmt, tokens);
+        } else if (auto vacuumStmt = dynamic_cast<VacuumStatement*>(ast.get())) {
+            visit(vacuumStmt, tokens);
         } else {
             throw std::runtime_error("[语义, (line 0, column 0), Unsupported AST node type]");
         }
@@ -167,6 +169,12 @@ void SemanticAnalyzer::visit(DropTableStatement* node, const std::vector<Token>&
     }
 }
 
+void SemanticAnalyzer::visit(VacuumStatement* node, const std::vector<Token>& tokens) {
+    if (!node->tableName.empty() && !tableExists(node->tableName)) {
+        reportError("Table '" + node->tableName + "' does not exist.", node->tableTokenIndex, tokens);
+    }
+}
+
 void SemanticAnalyzer::checkValueType(const std::string& value, DataType expectedType, size_t tokenIndex, const std::vector<Token>& tokens) {
     if (expectedType == DataType::INT) {
         bool isNumber = !value.empty() && std::all_of(value.begin(), value.end(), ::isdigit);
@@ -258,7 +266,7 @@ void SemanticAnalyzer::checkConstraintsOnInsert(const std::string& tableName,
     if (!storage_) return;
     int tid = storage_->get_table_id(to_lower(tableName));
     if (tid < 0) return;
-    auto rows = storage_->scan_table(tid);
+    pcsql::TupleLayout layout(schema);
 
     for (size_t i = 0; i < schema.columns.size(); ++i) {
         const auto& col = schema.columns[i];
@@ -268,12 +276,11 @@ void SemanticAnalyzer::checkConstraintsOnInsert(const std::string& tableName,
             reportError("NOT NULL constraint violated for column '" + col.name + "' on INSERT.", tokenIndex, tokens);
         }
         if (flags.unique || flags.primary) {
-            // 简单：文本相等即重复（与存储层一致）
-            for (const auto& kv : rows) {
-                auto fields_row = std::vector<std::string>{};
-                std::string cur; std::istringstream iss(kv.second);
-                while (std::getline(iss, cur, '|')) fields_row.push_back(cur);
-                if (i < fields_row.size() && fields_row[i] == v) {
+            // 按列类型比较是否相等（NULL 不与任何值相等）；流式扫描，不把整表读进内存
+            auto eq = pcsql::TuplePredicate::make(layout, i, "=", v);
+            if (!eq) continue;
+            for (auto it = storage_->table_iterator(tid); it.next();) {
+                if (eq->matches(pcsql::TupleView(layout, it.record(), &storage_->overflow_store()))) {
                     reportError("UNIQUE/PRIMARY KEY constraint violated for column '" + col.name + "' on INSERT.", tokenIndex, tokens);
                 }
             }
@@ -287,22 +294,6 @@ bool SemanticAnalyzer::parse_simple_condition(const std::string& cond, std::stri
     return !col.empty() && !op.empty() && !val.empty();
 }
 
-static inline int cmp_numeric(double a, double b) { return (a < b) ? -1 : ((a > b) ? 1 : 0); }
-
-bool SemanticAnalyzer::compare_typed(DataType type, const std::string& left, const std::string& op, const std::string& right) {
-    auto do_cmp = [&](int c)->bool {
-        if (op == "=") return c == 0; if (op == "!=") return c != 0; if (op == ">") return c > 0; if (op == "<") return c < 0; if (op == ">=") return c >= 0; if (op == "<=") return c <= 0; return false; };
-    if (type == DataType::INT) {
-        try { long long a = stoll(left); long long b = stoll(right); if (a==b) return do_cmp(0); return do_cmp(a<b?-1:1); } catch (...) { return false; }
-    } else if (type == DataType::DOUBLE) {
-        try { double a = stod(left); double b = stod(right); return do_cmp(cmp_numeric(a,b)); } catch (...) { return false; }
-    } else {
-        // 其余按字典序文本比较
-        int c = (left==right)?0:((left<right)?-1:1);
-        return do_cmp(c);
-    }
-}
-
 void SemanticAnalyzer::checkConstraintsOnUpdate(UpdateStatement* node,
                                                 const TableSchema& schema,
                                                 const std::vector<Token>& tokens) {
@@ -310,29 +301,26 @@ void SemanticAnalyzer::checkConstraintsOnUpdate(UpdateStatement* node,
     int tid = storage_->get_table_id(to_lower(node->tableName));
     if (tid < 0) return;
 
-    // 预加载所有行
-    auto rows = storage_->scan_table(tid);
-
     // 解析 WHERE（仅支持单一谓词 col op val，与执行引擎保持一致）
+    // 表按需流式扫描；只记下目标行的 RID。无 WHERE 时全部是目标，只计数
+    pcsql::TupleLayout layout(schema);
     std::set<std::pair<std::uint32_t,std::uint32_t>> target_rids; // page_id, slot_id
+    const bool all_targets = !node->whereClause;
+    std::size_t target_count = 0;
     if (node->whereClause) {
         if (auto* where = dynamic_cast<WhereClause*>(node->whereClause.get())) {
             std::string colw, op, val;
             if (parse_simple_condition(where->condition, colw, op, val)) {
                 std::string lcw = to_lower(colw);
-                int idxw = -1; DataType dtw = DataType::UNKNOWN;
+                int idxw = -1;
                 for (size_t i = 0; i < schema.columns.size(); ++i) {
-                    if (to_lower(schema.columns[i].name) == lcw) { idxw = static_cast<int>(i); dtw = schema.columns[i].type; break; }
+                    if (to_lower(schema.columns[i].name) == lcw) { idxw = static_cast<int>(i); break; }
                 }
-                if (idxw >= 0) {
-                    for (const auto& kv : rows) {
-                        std::vector<std::string> fields; fields.reserve(schema.columns.size());
-                        std::string cur; std::istringstream iss(kv.second);
-                        while (std::getline(iss, cur, '|')) fields.push_back(cur);
-                        if (idxw < static_cast<int>(fields.size())) {
-                            if (compare_typed(dtw, fields[idxw], op, val)) {
-                                target_rids.insert({kv.first.page_id, kv.first.slot_id});
-                            }
+                auto pred = idxw >= 0 ? pcsql::TuplePredicate::make(layout, idxw, op, val) : std::nullopt;
+                if (pred) {
+                    for (auto it = storage_->table_iterator(tid); it.next();) {
+                        if (pred->matches(pcsql::TupleView(layout, it.record(), &storage_->overflow_store()))) {
+                            target_rids.insert({it.rid().page_id, it.rid().slot_id});
                         }
                     }
                 }
@@ -340,8 +328,9 @@ void SemanticAnalyzer::checkConstraintsOnUpdate(UpdateStatement* node,
         }
     } else {
         // 无 WHERE => 目标为所有行
-        for (const auto& kv : rows) target_rids.insert({kv.first.page_id, kv.first.slot_id});
+        for (auto it = storage_->table_iterator(tid); it.next();) ++target_count;
     }
+    if (!all_targets) target_count = target_rids.size();
 
     // 针对每个被赋值的列检查约束
     for (const auto& assign : node->assignments) {
@@ -362,18 +351,18 @@ void SemanticAnalyzer::checkConstraintsOnUpdate(UpdateStatement* node,
         // UNIQUE/PRIMARY：基本检查
         if (flags.unique || flags.primary) {
             // 统计非目标行中是否已存在该值
-            for (const auto& kv : rows) {
-                bool is_target = target_rids.count({kv.first.page_id, kv.first.slot_id}) > 0;
-                if (is_target) continue; // 非目标行的重复才会导致冲突（目标行会被赋为同一值，下方再判）
-                std::vector<std::string> fields; fields.reserve(schema.columns.size());
-                std::string cur; std::istringstream iss(kv.second);
-                while (std::getline(iss, cur, '|')) fields.push_back(cur);
-                if (idx < static_cast<int>(fields.size()) && fields[idx] == new_val) {
-                    reportError("UNIQUE/PRIMARY KEY constraint violated for column '" + logicalName + "' on UPDATE: value already exists in another row.", node->tableTokenIndex, tokens);
+            auto eq = pcsql::TuplePredicate::make(layout, idx, "=", new_val);
+            if (!all_targets && eq) {
+                for (auto it = storage_->table_iterator(tid); it.next();) {
+                    bool is_target = target_rids.count({it.rid().page_id, it.rid().slot_id}) > 0;
+                    if (is_target) continue; // 非目标行的重复才会导致冲突（目标行会被赋为同一值，下方再判）
+                    if (eq->matches(pcsql::TupleView(layout, it.record(), &storage_->overflow_store()))) {
+                        reportError("UNIQUE/PRIMARY KEY constraint violated for column '" + logicalName + "' on UPDATE: value already exists in another row.", node->tableTokenIndex, tokens);
+                    }
                 }
             }
             // 若目标包含 2 行以上，全部设置为同一值也会冲突
-            if (target_rids.size() >= 2) {
+            if (target_count >= 2) {
                 reportError("UNIQUE/PRIMARY KEY constraint violated for column '" + logicalName + "' on UPDATE: multiple target rows would share the same value.", node->tableTokenIndex, tokens);
             }
         }
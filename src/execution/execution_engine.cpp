@@ -3,10 +3,13 @@
 #include <iostream>
 #include <cctype>
 #include <utility>
+#include <iterator>
 #include <limits>
 #include <chrono>
 #include <ctime>
 #include <iomanip>
+#include <optional>
+#include <string_view>
 #include <algorithm>
 
 // ---- Local helpers: string utils and condition evaluation ----
@@ -22,12 +25,6 @@ static std::string trim(std::string s) {
     return s.substr(b, e - b);
 }
 
-static std::vector<std::string> split(const std::string& s, char delim) {
-    std::vector<std::string> out; std::string cur; std::istringstream iss(s);
-    while (std::getline(iss, cur, delim)) out.push_back(cur);
-    return out;
-}
-
 static std::string join(const std::vector<std::string>& v, const char* sep) {
     std::ostringstream os;
     for (size_t i = 0; i < v.size(); ++i) { if (i) os << sep; os << v[i]; }
@@ -84,45 +81,17 @@ static bool parse_condition(const std::string& cond, std::string& col, std::stri
     return false;
 }
 
-static bool to_bool_ci(const std::string& s) {
-    auto t = to_lower(s);
-    return (t=="true" || t=="1" || t=="yes" || t=="y");
-}
-
-static bool compare_typed(DataType type, const std::string& l, const std::string& op, const std::string& r) {
-    auto cmp = [&](auto lhs, auto rhs)->int { if (lhs < rhs) return -1; if (lhs > rhs) return 1; return 0; };
-    int c = 0;
-    try {
-        switch (type) {
-            case DataType::INT: { long long li = std::stoll(l); long long ri = std::stoll(r); c = cmp(li, ri); break; }
-            case DataType::DOUBLE: { double ld = std::stod(l); double rd = std::stod(r); c = cmp(ld, rd); break; }
-            case DataType::BOOLEAN: { bool lb = to_bool_ci(l); bool rb = to_bool_ci(r); c = cmp(lb, rb); break; }
-            case DataType::TIMESTAMP: { c = cmp(l, r); break; }
-            case DataType::VARCHAR: {
-                // 防御式处理：去除可能存在的包裹引号，保证与解析阶段一致
-                auto strip_quotes = [](std::string& s){
-                    if (s.size() >= 2 && ((s.front()=='\'' && s.back()=='\'') || (s.front()=='"' && s.back()=='"'))) {
-                        s = s.substr(1, s.size() - 2);
-                    }
-                };
-                std::string ls = l, rs = r;
-                strip_quotes(ls);
-                strip_quotes(rs);
-                c = cmp(ls, rs);
-                break;
-            }
-            default: { c = cmp(l, r); break; }
-        }
-    } catch (...) {
-        c = (l < r ? -1 : (l > r ? 1 : 0));
+// 单谓词 WHERE（col op val）解析为列上的 TuplePredicate，供流式扫描逐行原地判断
+// nullopt 表示 WHERE 无法解析或列不存在
+static std::optional<pcsql::TuplePredicate> make_row_filter(const std::string& cond, const TableSchema& schema,
+                                                            const pcsql::TupleLayout& layout) {
+    std::string col, op, val;
+    if (!parse_condition(cond, col, op, val)) return std::nullopt;
+    std::string col_lc = to_lower(col);
+    for (size_t i = 0; i < schema.columns.size(); ++i) {
+        if (to_lower(schema.columns[i].name) == col_lc) return pcsql::TuplePredicate::make(layout, i, op, val);
     }
-    if (op == "=") return c == 0;
-    if (op == "!=") return c != 0;
-    if (op == ">") return c > 0;
-    if (op == "<") return c < 0;
-    if (op == ">=") return c >= 0;
-    if (op == "<=") return c <= 0;
-    return false;
+    return std::nullopt;
 }
 
 // Forward declarations for helper utilities defined later in this file
@@ -131,10 +100,14 @@ static bool has_auto_increment(const std::vector<std::string>& cons);
 static bool has_default_current_timestamp(const std::vector<std::string>& cons);
 static bool is_null_or_default_literal(const std::string& v);
 static std::string now_timestamp_string();
-std::string ExecutionEngine::format_rows(const std::vector<std::pair<pcsql::RID, std::string>>& rows) {
+std::string ExecutionEngine::format_rows(const std::vector<std::pair<pcsql::RID, std::string>>& rows,
+                                         const pcsql::TupleLayout& layout,
+                                         const pcsql::OverflowStore* overflow) {
     std::ostringstream os;
     for (const auto& [rid, bytes] : rows) {
-        os << "(" << rid.page_id << "," << rid.slot_id << ") => " << bytes << "\n";
+        os << "(" << rid.page_id << "," << rid.slot_id << ") => ";
+        if (layout.empty()) os << bytes; else os << pcsql::TupleView(layout, bytes, overflow).to_text();
+        os << "\n";
     }
     return os.str();
 }
@@ -150,6 +123,7 @@ std::string ExecutionEngine::execute(const Compiler::CompiledUnit& unit) {
         if (auto* u = dynamic_cast<UpdateStatement*>(unit.ast.get())) return handleUpdate(u);
         // 新增：DROP TABLE
         if (auto* dt = dynamic_cast<DropTableStatement*>(unit.ast.get())) return handleDropTable(dt);
+        if (auto* v = dynamic_cast<VacuumStatement*>(unit.ast.get())) return handleVacuum(v);
         return "[ExecutionEngine] Unsupported statement";
     } catch (const std::exception& ex) {
         return std::string("[ExecutionEngine] Error: ") + ex.what();
@@ -202,19 +176,12 @@ std::string ExecutionEngine::handleInsert(InsertStatement* stmt) {
 
     // Load schema to interpret constraints and types
     const auto& schema = storage_.get_table_schema(to_lower(stmt->tableName));
+    pcsql::TupleLayout layout(schema);
 
     // Start with provided values (already validated by semantic analyzer for count/type basics)
     std::vector<std::string> vals = stmt->values;
     vals.resize(schema.columns.size());
 
-    // Preload existing rows for AUTO_INCREMENT max scanning (only if needed)
-    bool any_auto_inc = false;
-    for (const auto& col : schema.columns) if (has_auto_increment(col.constraints)) { any_auto_inc = true; break; }
-    std::vector<std::pair<pcsql::RID, std::string>> rows;
-    if (any_auto_inc) {
-        rows = storage_.scan_table(tid);
-    }
-
     for (size_t i = 0; i < schema.columns.size(); ++i) {
         const auto& col = schema.columns[i];
         std::string& v = vals[i];
@@ -234,16 +201,12 @@ std::string ExecutionEngine::handleInsert(InsertStatement* stmt) {
             if (need_generate) {
                 long long max_val = 0;
                 bool found = false;
-                for (const auto& kv : rows) {
-                    auto fields = split(kv.second, '|');
-                    if (i < fields.size()) {
-                        try {
-                            long long cur = std::stoll(fields[i]);
-                            if (!found || cur > max_val) { max_val = cur; found = true; }
-                        } catch (...) {
-                            // ignore non-numeric
-                        }
-                    }
+                // 流式扫描取当前最大值，不把整表读进内存；定长槽直接读 int64，NULL 跳过
+                for (auto it = storage_.table_iterator(tid); it.next();) {
+                    pcsql::TupleView row(layout, it.record(), &storage_.overflow_store());
+                    if (row.is_null(i)) continue;
+                    long long cur = row.get_int(i);
+                    if (!found || cur > max_val) { max_val = cur; found = true; }
                 }
                 long long next = found ? (max_val + 1) : 1;
                 v = std::to_string(next);
@@ -251,7 +214,11 @@ std::string ExecutionEngine::handleInsert(InsertStatement* stmt) {
         }
     }
 
-    std::string row = join(vals, "|");
+    for (auto& v : vals) {
+        if (to_lower(v) == "default") v = "NULL"; // 没有默认值可用的 DEFAULT 即 NULL
+    }
+    // 有表结构的表按二进制元组存储（过大的 VARCHAR 值放到溢出页）；值与列类型不符时抛异常，由 execute 转为错误信息
+    std::string row = layout.empty() ? join(vals, "|") : storage_.encode_row(tid, layout, vals);
     auto rid = storage_.insert_record(tid, row);
     // 新增：插入后更新该表相关索引
     storage_.update_indexes_on_insert(tid, row, rid);
@@ -277,6 +244,8 @@ bool ExecutionEngine::buildSelectRows(SelectStatement* stmt,
     }
 
     std::vector<std::string> diag;
+    const auto schema = storage_.get_table_schema(to_lower(stmt->fromTable));
+    pcsql::TupleLayout layout(schema);
 
     std::vector<std::pair<pcsql::RID, std::string>> rows;
     bool used_index = false;
@@ -287,7 +256,6 @@ bool ExecutionEngine::buildSelectRows(SelectStatement* stmt,
         if (auto* where = dynamic_cast<WhereClause*>(stmt->whereClause.get())) {
             if (parse_condition(where->condition, parsed_col, parsed_op, parsed_val)) {
                 diag.push_back("WHERE parsed: " + parsed_col + " " + parsed_op + " " + parsed_val);
-                const auto& schema = storage_.get_table_schema(to_lower(stmt->fromTable));
                 std::string col_lc = to_lower(parsed_col);
                 int where_col_idx = -1; DataType where_dtype = DataType::UNKNOWN;
                 for (size_t i = 0; i < schema.columns.size(); ++i) {
@@ -416,36 +384,46 @@ bool ExecutionEngine::buildSelectRows(SelectStatement* stmt,
         }
     }
 
+    std::size_t candidates = rows.size();
+    bool filtered_in_scan = false;
     if (!used_index) {
-        rows = storage_.scan_table(tid);
+        // 全表扫描：流式读取，边扫边按 WHERE 过滤，只复制命中的行
+        std::optional<pcsql::TuplePredicate> filter;
+        if (auto* where = dynamic_cast<WhereClause*>(stmt->whereClause.get())) {
+            filter = make_row_filter(where->condition, schema, layout);
+            filtered_in_scan = filter.has_value();
+        }
+        // 按页区间（morsel）并行扫描过滤，各段结果按页序拼接，与串行扫描顺序一致
+        struct ScanPart { std::size_t scanned = 0; std::vector<std::pair<pcsql::RID, std::string>> rows; };
+        auto parts = storage_.parallel_scan<ScanPart>(tid, [&](pcsql::TableIterator& it, ScanPart& part) {
+            while (it.next()) {
+                ++part.scanned;
+                if (!filter || filter->matches(pcsql::TupleView(layout, it.record(), &storage_.overflow_store()))) part.rows.emplace_back(it.rid(), std::string(it.record()));
+            }
+        });
+        candidates = 0;
+        for (auto& part : parts) {
+            candidates += part.scanned;
+            rows.insert(rows.end(), std::make_move_iterator(part.rows.begin()), std::make_move_iterator(part.rows.end()));
+        }
         strategy = "full_scan";
     }
-    diag.push_back(std::string("Index hit: ") + (used_index ? "true" : "false") + ", strategy: " + strategy + ", candidates: " + std::to_string(rows.size()));
+    diag.push_back(std::string("Index hit: ") + (used_index ? "true" : "false") + ", strategy: " + strategy + ", candidates: " + std::to_string(candidates));
+    if (filtered_in_scan) {
+        diag.push_back("After WHERE filter: " + std::to_string(rows.size()) + " (before=" + std::to_string(candidates) + ")");
+    }
 
-    if (stmt->whereClause) {
+    if (stmt->whereClause && used_index) {
         if (auto* where = dynamic_cast<WhereClause*>(stmt->whereClause.get())) {
-            std::string col, op, val;
-            if (parse_condition(where->condition, col, op, val)) {
-                std::string col_lc = to_lower(col);
-                const auto& schema = storage_.get_table_schema(to_lower(stmt->fromTable));
-                int idx = -1; DataType dtype = DataType::UNKNOWN;
-                for (size_t i = 0; i < schema.columns.size(); ++i) {
-                    if (to_lower(schema.columns[i].name) == col_lc) { idx = static_cast<int>(i); dtype = schema.columns[i].type; break; }
-                }
-                if (idx >= 0) {
-                    size_t before = rows.size();
-                    std::vector<std::pair<pcsql::RID, std::string>> filtered;
-                    filtered.reserve(rows.size());
-                    for (const auto& kv : rows) {
-                        auto fields = split(kv.second, '|');
-                        if (idx < static_cast<int>(fields.size())) {
-                            const std::string& f = fields[idx];
-                            if (compare_typed(dtype, f, op, val)) filtered.push_back(kv);
-                        }
-                    }
-                    rows.swap(filtered);
-                    diag.push_back("After WHERE filter: " + std::to_string(rows.size()) + " (before=" + std::to_string(before) + ")");
+            if (auto filter = make_row_filter(where->condition, schema, layout)) {
+                size_t before = rows.size();
+                std::vector<std::pair<pcsql::RID, std::string>> filtered;
+                filtered.reserve(rows.size());
+                for (auto& kv : rows) {
+                    if (filter->matches(pcsql::TupleView(layout, kv.second, &storage_.overflow_store()))) filtered.push_back(std::move(kv));
                 }
+                rows.swap(filtered);
+                diag.push_back("After WHERE filter: " + std::to_string(rows.size()) + " (before=" + std::to_string(before) + ")");
             }
         }
     }
@@ -473,7 +451,7 @@ std::string ExecutionEngine::handleSelect(SelectStatement* stmt) {
         std::string line;
         while (std::getline(iss, line)) os << "[QUERY] " << line << "\n";
     }
-    os << format_rows(rows);
+    os << format_rows(rows, storage_.table_layout(to_lower(stmt->fromTable)), &storage_.overflow_store());
     return os.str();
 }
 
@@ -481,47 +459,34 @@ std::string ExecutionEngine::handleDelete(DeleteStatement* stmt) {
     int tid = storage_.get_table_id(to_lower(stmt->tableName));
     if (tid < 0) return "Table not found: " + stmt->tableName;
 
-    auto rows = storage_.scan_table(tid);
-
-    // If there is a WHERE clause, filter rows first (type-aware comparison, same as SELECT)
+    // If there is a WHERE clause, filter rows while streaming the table (type-aware comparison,
+    // same as SELECT); only the targets are kept. A WHERE that cannot be parsed or
+    // names an unknown column (should have been caught by the semantic analyzer) deletes nothing.
+    const auto& schema = storage_.get_table_schema(to_lower(stmt->tableName));
+    pcsql::TupleLayout layout(schema);
+    std::optional<pcsql::TuplePredicate> filter;
+    bool delete_all = !stmt->whereClause;
+    if (auto* where = dynamic_cast<WhereClause*>(stmt->whereClause.get())) {
+        filter = make_row_filter(where->condition, schema, layout);
+    }
+    bool filter_ok = delete_all || filter.has_value();
+    // 目标行内容留到删除后维护索引（删除的槽会被后续插入复用，索引项不能再指向它）
     std::vector<std::pair<pcsql::RID, std::string>> targets;
-    if (stmt->whereClause) {
-        if (auto* where = dynamic_cast<WhereClause*>(stmt->whereClause.get())) {
-            std::string col, op, val;
-            if (parse_condition(where->condition, col, op, val)) {
-                std::string col_lc = to_lower(col);
-                const auto& schema = storage_.get_table_schema(to_lower(stmt->tableName));
-                int idx = -1; DataType dtype = DataType::UNKNOWN;
-                for (size_t i = 0; i < schema.columns.size(); ++i) {
-                    if (to_lower(schema.columns[i].name) == col_lc) { idx = static_cast<int>(i); dtype = schema.columns[i].type; break; }
-                }
-                if (idx >= 0) {
-                    targets.reserve(rows.size());
-                    for (const auto& kv : rows) {
-                        auto fields = split(kv.second, '|');
-                        if (idx < static_cast<int>(fields.size())) {
-                            const std::string& f = fields[idx];
-                            if (compare_typed(dtype, f, op, val)) targets.push_back(kv);
-                        }
-                    }
-                } else {
-                    // Column not found by some reason (should have been caught by semantic analyzer) -> no-op for safety
-                    targets.clear();
-                }
-            } else {
-                // WHERE exists but cannot be parsed -> do not delete anything for safety
-                targets.clear();
-            }
+    if (filter_ok) {
+        for (auto it = storage_.table_iterator(tid); it.next();) {
+            if (delete_all || filter->matches(pcsql::TupleView(layout, it.record(), &storage_.overflow_store()))) targets.emplace_back(it.rid(), std::string(it.record()));
         }
-    } else {
-        // No WHERE -> delete all rows (explicit full table delete)
-        targets = std::move(rows);
     }
 
+    // 扫描结束、页已释放后再删除（迭代器持有页闩时不能写同一页）
     size_t n = 0;
-    for (auto& kv : targets) {
-        n += storage_.delete_record(kv.first) ? 1 : 0;
+    for (const auto& [rid, row] : targets) {
+        if (!storage_.delete_record(rid)) continue;
+        storage_.update_indexes_on_delete(tid, row, rid);
+        storage_.free_overflow(layout, row);
+        ++n;
     }
+    storage_.note_dead_rows(tid, n);
 
     std::ostringstream os; os << "DELETE OK count=" << n; return os.str();
 }
@@ -530,9 +495,6 @@ std::string ExecutionEngine::handleUpdate(UpdateStatement* stmt) {
     int tid = storage_.get_table_id(to_lower(stmt->tableName));
     if (tid < 0) return "Table not found: " + stmt->tableName;
 
-    // Load all rows to determine targets
-    auto rows = storage_.scan_table(tid);
-
     // Build assignment plan: map column name -> (index, type, value)
     const auto& schema = storage_.get_table_schema(to_lower(stmt->tableName));
     struct Assign { int idx; DataType type; std::string value; };
@@ -551,58 +513,56 @@ std::string ExecutionEngine::handleUpdate(UpdateStatement* stmt) {
         // If column not found (should be prevented by semantic analyzer), just skip for safety
     }
 
-    // Determine target rows based on WHERE clause (same logic as SELECT/DELETE)
+    // Determine target rows based on WHERE clause (same logic as SELECT/DELETE) while streaming
+    // the table; only matching rows are copied. A WHERE that cannot be parsed or names an unknown
+    // column updates nothing for safety.
     std::vector<std::pair<pcsql::RID, std::string>> targets;
-    if (stmt->whereClause) {
-        if (auto* where = dynamic_cast<WhereClause*>(stmt->whereClause.get())) {
-            std::string col, op, val;
-            if (parse_condition(where->condition, col, op, val)) {
-                std::string col_lc = to_lower(col);
-                int idx = -1; DataType dtype = DataType::UNKNOWN;
-                for (size_t i = 0; i < schema.columns.size(); ++i) {
-                    if (to_lower(schema.columns[i].name) == col_lc) { idx = static_cast<int>(i); dtype = schema.columns[i].type; break; }
-                }
-                if (idx >= 0) {
-                    targets.reserve(rows.size());
-                    for (const auto& row : rows) {
-                        auto fields = split(row.second, '|');
-                        if (idx < static_cast<int>(fields.size())) {
-                            const std::string& f = fields[idx];
-                            if (compare_typed(dtype, f, op, val)) targets.push_back(row);
-                        }
-                    }
-                } else {
-                    // WHERE references unknown column -> do nothing for safety
-                    targets.clear();
-                }
-            } else {
-                // WHERE cannot be parsed -> do nothing for safety
-                targets.clear();
-            }
+    pcsql::TupleLayout layout(schema);
+    std::optional<pcsql::TuplePredicate> filter;
+    bool update_all = !stmt->whereClause;
+    if (auto* where = dynamic_cast<WhereClause*>(stmt->whereClause.get())) {
+        filter = make_row_filter(where->condition, schema, layout);
+    }
+    if (update_all || filter) {
+        for (auto it = storage_.table_iterator(tid); it.next();) {
+            if (update_all || filter->matches(pcsql::TupleView(layout, it.record(), &storage_.overflow_store()))) targets.emplace_back(it.rid(), std::string(it.record()));
         }
-    } else {
-        // No WHERE: update all rows
-        targets = std::move(rows);
     }
 
     // Apply assignments to each target row and write back
     size_t n = 0;
     for (const auto& kv : targets) {
-        auto fields = split(kv.second, '|');
+        // 解码为文本字段，改写后重新编码（旧格式的文本行借此升级为二进制元组）。
+        // 溢出列不读出：未被赋值的沿用原引用，只有被赋值的列才写新链
+        pcsql::TupleView view(layout, kv.second);
+        std::vector<std::string> fields(layout.columns());
+        std::vector<std::optional<pcsql::OverflowRef>> kept(layout.columns());
+        for (size_t i = 0; i < layout.columns(); ++i) {
+            if ((kept[i] = view.external_ref(i))) continue;
+            fields[i] = view.text(i);
+        }
         bool changed = false;
         for (const auto& a : assigns) {
             if (a.idx >= 0 && a.idx < static_cast<int>(fields.size())) {
                 // For strings, lexer already removed quotes; for numbers they are raw digits.
                 fields[a.idx] = a.value;
+                kept[a.idx].reset();
                 changed = true;
             }
         }
         if (changed) {
-            std::string new_row = join(fields, "|");
-            if (storage_.update_record(kv.first, new_row)) ++n;
+            std::string new_row = layout.empty() ? join(fields, "|") : storage_.encode_row(tid, layout, fields, kept);
+            // 沿用的链两边共享；被替换的链：更新成功则释放旧的，失败则释放新写的
+            if (storage_.update_record(kv.first, new_row)) {
+                storage_.free_overflow(layout, kv.second, kept);
+                ++n;
+            } else {
+                storage_.free_overflow(layout, new_row, kept);
+            }
         }
     }
 
+    storage_.note_dead_rows(tid, n);
     std::ostringstream os; os << "UPDATE OK count=" << n; return os.str();
 }
 
@@ -630,6 +590,28 @@ std::string ExecutionEngine::handleDropTable(DropTableStatement* stmt) {
     }
 }
 
+std::string ExecutionEngine::handleVacuum(VacuumStatement* stmt) {
+    std::vector<std::int32_t> tids;
+    if (!stmt->tableName.empty()) {
+        int tid = storage_.get_table_id(to_lower(stmt->tableName));
+        if (tid < 0) return "Table not found: " + stmt->tableName;
+        tids.push_back(tid);
+    } else {
+        // 不带表名：清理所有用户表（系统目录表不动）
+        for (auto tid : storage_.table_ids()) {
+            if (storage_.get_table_name(tid).rfind("sys_", 0) != 0) tids.push_back(tid);
+        }
+    }
+    std::ostringstream os;
+    os << "VACUUM OK";
+    for (auto tid : tids) {
+        auto st = storage_.vacuum_table(tid);
+        os << "\n" << storage_.get_table_name(tid) << ": pages " << st.pages_before << " -> " << st.pages_after
+           << ", rows moved=" << st.rows_moved << ", stubs collapsed=" << st.stubs_collapsed << ", live rows=" << st.live_rows;
+    }
+    return os.str();
+}
+
 static bool constraint_set_contains(const std::vector<std::string>& cons, const std::string& token_lower) {
     for (auto c : cons) {
         auto lc = to_lower(c);
@@ -31,11 +31,12 @@ int main() {
         int tid_noidx = eng.create_table("t_noidx", cols);
         int tid_idx   = eng.create_table("t_idx", cols);
 
-        // 写入 1000 行：id = 1..1000, name = name{id}
+        // 写入 1000 行：id = 1..1000, name = name{id}（按表结构编码为二进制元组）
+        TupleLayout layout(eng.get_table_schema("t_noidx"));
         for (int i = 1; i <= 1000; ++i) {
-            std::ostringstream os; os << i << '|' << "name" << i;
-            (void)eng.insert_record(tid_noidx, os.str());
-            (void)eng.insert_record(tid_idx,   os.str());
+            std::string row = encode_tuple(layout, {std::to_string(i), "name" + std::to_string(i)});
+            (void)eng.insert_record(tid_noidx, row);
+            (void)eng.insert_record(tid_idx,   row);
         }
 
         // 在 t_idx(id) 上创建索引
@@ -49,12 +50,9 @@ int main() {
         auto rows_noidx = eng.scan_table(tid_noidx);
         std::string found_noidx;
         for (const auto& kv : rows_noidx) {
-            const std::string& row = kv.second;
-            // 解析第一列 id
-            std::size_t pos_bar = row.find('|');
-            std::string s_id = (pos_bar == std::string::npos) ? row : row.substr(0, pos_bar);
-            int id = 0; try { id = std::stoi(s_id); } catch (...) { continue; }
-            if (id == target_id) { found_noidx = row; break; }
+            // 第一列 id 是定长槽，直接读出
+            TupleView row(layout, kv.second);
+            if (!row.is_null(0) && row.get_int(0) == target_id) { found_noidx = row.to_text(); break; }
         }
         auto t2 = std::chrono::steady_clock::now();
         auto dur_scan_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
@@ -69,7 +67,7 @@ int main() {
         std::cout << "数据量: 1000 行, 目标: id=" << target_id << "\n";
         std::cout << "[无索引] 全表扫描耗时: " << dur_scan_us << " us, 结果: " << (found_noidx.empty()?"<未找到>":found_noidx) << "\n";
         std::cout << "[有索引] 索引等值查找耗时: " << dur_index_us << " us, 结果: "
-                  << (rows_idx.empty()?"<未找到>":rows_idx.front().second) << "\n";
+                  << (rows_idx.empty()?"<未找到>":TupleView(layout, rows_idx.front().second).to_text()) << "\n";
 
         // 打印缓冲池统计，便于观察 I/O 行为差异
         eng.flush_all();
@@ -2,6 +2,7 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <cstdio>
 #include <cstring>
 #include <string>
 #include <vector>
@@ -149,11 +150,133 @@ static std::vector<uint8_t> make_text_row(const std::vector<std::string>& fields
 static std::atomic<bool> g_stop{false};
 static void on_signal(int /*sig*/) { g_stop.store(true); }
 
+// 磁盘参数：PCSQL_EXTENT_MB 控制 data.db 每次预分配的 extent 大小（1~64 MB）
+static DiskOptions disk_options_from_env(){
+    DiskOptions opts;
+    if (const char* env = std::getenv("PCSQL_EXTENT_MB")) {
+        try{
+            long mb = std::stol(env);
+            if (mb >= 1 && mb <= 64) opts.extent_bytes = static_cast<std::size_t>(mb) << 20;
+        }catch(...){ /* ignore invalid */ }
+    }
+    // 新建数据库的页大小：PCSQL_PAGE_KB=4|8|16|32|64（已有 data.db 以超级块为准）
+    if (const char* env = std::getenv("PCSQL_PAGE_KB")) {
+        try{
+            long kb = std::stol(env);
+            if (kb > 0 && valid_page_size(static_cast<std::size_t>(kb) << 10)) opts.page_size = static_cast<std::size_t>(kb) << 10;
+        }catch(...){ /* ignore invalid */ }
+    }
+    // PCSQL_DIRECT_IO=1|on|true|yes：以 O_DIRECT 打开 data.db，页只缓存在缓冲池中
+    if (const char* env = std::getenv("PCSQL_DIRECT_IO")) {
+        std::string v = to_lower(std::string(env));
+        opts.direct_io = (v == "1" || v == "on" || v == "true" || v == "yes");
+    }
+    // 异步 I/O 后端：PCSQL_IO_BACKEND=auto|threadpool|io_uring
+    if (const char* env = std::getenv("PCSQL_IO_BACKEND")) {
+        std::string v = to_lower(std::string(env));
+        if (v == "threadpool") opts.io_backend = IoBackend::ThreadPool;
+        else if (v == "io_uring" || v == "iouring") opts.io_backend = IoBackend::IoUring;
+    }
+    return opts;
+}
+
+// 后台写线程：PCSQL_BGWRITER_MS 为两轮之间的间隔（0 关闭，默认 100ms），
+// PCSQL_DIRTY_RATIO 为允许保持脏的帧百分比（默认 10），PCSQL_BGWRITER_MAXPAGES 为每轮最多写回的页数
+static bool writer_options_from_env(WriterOptions& opts){
+    if (const char* env = std::getenv("PCSQL_BGWRITER_MS")) {
+        try{
+            long ms = std::stol(env);
+            if (ms <= 0) return false;
+            opts.interval = std::chrono::milliseconds(ms);
+        }catch(...){ /* ignore invalid */ }
+    }
+    if (const char* env = std::getenv("PCSQL_DIRTY_RATIO")) {
+        try{
+            long pct = std::stol(env);
+            if (pct >= 0 && pct <= 100) opts.dirty_ratio_target = static_cast<double>(pct) / 100.0;
+        }catch(...){ /* ignore invalid */ }
+    }
+    if (const char* env = std::getenv("PCSQL_BGWRITER_MAXPAGES")) {
+        try{
+            long n = std::stol(env);
+            if (n > 0) opts.max_pages_per_round = static_cast<std::size_t>(n);
+        }catch(...){ /* ignore invalid */ }
+    }
+    return true;
+}
+
+// 缓冲池大小：字节数（可带 K/M/G 后缀）或 AUTO（按 cgroup 内存上限/物理内存的 1/4），换算为帧数
+static bool parse_pool_size(const std::string& text, std::size_t page_size, std::size_t& frames){
+    std::string v = to_lower(trim(text));
+    if (v == "auto") { frames = BufferManager::auto_capacity(page_size); return true; }
+    if (v.empty()) return false;
+    std::size_t shift = 0;
+    switch (v.back()) {
+        case 'k': shift = 10; break;
+        case 'm': shift = 20; break;
+        case 'g': shift = 30; break;
+        default: break;
+    }
+    if (shift) v.pop_back();
+    try{
+        std::size_t used = 0;
+        unsigned long long n = std::stoull(v, &used);
+        if (used != v.size()) return false;
+        frames = static_cast<std::size_t>((n << shift) / page_size);
+    }catch(...){ return false; }
+    return frames > 0 && frames <= BufferManager::MAX_CAPACITY;
+}
+
+// SHOW BUFFER STATUS：以 (Variable_name, Value) 行输出缓冲池总计、按页类型/按表的命中/未命中/淘汰，以及未命中延迟分布
+static std::vector<std::pair<std::string, std::string>> buffer_status_rows(StorageEngine& storage){
+    BufferStatus st = storage.buffer_status();
+    std::vector<std::pair<std::string, std::string>> rows;
+    auto add = [&](const std::string& k, auto v){ rows.emplace_back(k, std::to_string(v)); };
+    auto add_counters = [&](const std::string& prefix, const PageCounters& c){
+        add(prefix + "_hits", c.hits);
+        add(prefix + "_misses", c.misses);
+        add(prefix + "_evictions", c.evictions);
+        std::size_t refs = c.hits + c.misses;
+        char ratio[32]; std::snprintf(ratio, sizeof(ratio), "%.4f", refs ? static_cast<double>(c.hits) / static_cast<double>(refs) : 0.0);
+        rows.emplace_back(prefix + "_hit_ratio", ratio);
+    };
+    add("buffer_pool_capacity", st.capacity);
+    add("buffer_pool_page_size", storage.page_size());
+    add("buffer_pool_resident", st.resident);
+    add("buffer_pool_dirty", st.dirty);
+    add_counters("buffer_pool", PageCounters{st.totals.hits, st.totals.misses, st.totals.evictions});
+    add("buffer_pool_flushes", st.totals.flushes);
+    add("buffer_pool_background_flushes", st.totals.background_flushes);
+    add("buffer_pool_dirty_evictions", st.totals.dirty_evictions);
+    add("buffer_pool_readahead_hits", st.totals.readahead_hits);
+    add("buffer_pool_prewarmed", st.totals.prewarmed);
+    for (std::size_t k = 0; k < PAGE_KIND_COUNT; ++k) {
+        const auto& c = st.by_kind[k];
+        if (c.hits + c.misses + c.evictions == 0) continue;
+        add_counters(std::string("kind_") + to_string(static_cast<PageKind>(k)), c);
+    }
+    for (const auto& [tid, c] : st.by_table) {
+        std::string name = storage.get_table_name(tid);
+        add_counters("table_" + (name.empty() ? "#" + std::to_string(tid) : name), c);
+    }
+    const auto& h = st.miss_latency;
+    add("miss_latency_count", h.count);
+    add("miss_latency_avg_us", h.count ? h.total_us / h.count : 0);
+    add("miss_latency_p50_us", h.percentile(50));
+    add("miss_latency_p95_us", h.percentile(95));
+    add("miss_latency_p99_us", h.percentile(99));
+    for (std::size_t b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+        if (h.buckets[b] == 0) continue;
+        add("miss_latency_lt_" + std::to_string(LatencyHistogram::bucket_limit(b)) + "us", h.buckets[b]);
+    }
+    return rows;
+}
+
 class MySQLServer {
 public:
     //构造函数，初始化存储引擎和执行引擎。
     MySQLServer()
-        : storage_("./storage_data", 64, Policy::LRU, true), exec_(storage_) {
+        : storage_("./storage_data", 64, Policy::LRU, true, disk_options_from_env()), exec_(storage_) {
         // 支持通过环境变量默认开启索引跟踪：PCSQL_INDEX_TRACE=1|on|true|yes
         if (const char* env = std::getenv("PCSQL_INDEX_TRACE")) {
             std::string v = to_lower(std::string(env));
@@ -162,6 +285,41 @@ public:
                 std::cout << "[MySQLCompat] PCSQL_INDEX_TRACE enabled by env" << std::endl;
             }
         }
+        // 缓冲池预热：重新装入上次退出时的常驻页（PCSQL_WARMUP=0|off|false|no 关闭）
+        bool warmup = true;
+        if (const char* env = std::getenv("PCSQL_WARMUP")) {
+            std::string v = to_lower(std::string(env));
+            warmup = !(v == "0" || v == "off" || v == "false" || v == "no");
+        }
+        // PCSQL_BUFFER_POOL=<bytes[K|M|G]>|auto：启动时的缓冲池大小（默认 64 帧），运行时可用 SET GLOBAL buffer_pool_size 调整
+        if (const char* env = std::getenv("PCSQL_BUFFER_POOL")) {
+            std::size_t frames = 0;
+            if (parse_pool_size(env, storage_.page_size(), frames)) {
+                storage_.resize_buffer_pool(frames);
+                std::cout << "[MySQLCompat] buffer pool " << frames << " frames" << std::endl;
+            }
+        }
+        // PCSQL_SCAN_WORKERS=<n>：全表扫描/建索引的并行线程数（默认 CPU 核数，1 为串行）
+        if (const char* env = std::getenv("PCSQL_SCAN_WORKERS")) {
+            char* end = nullptr;
+            unsigned long n = std::strtoul(env, &end, 10);
+            if (end != env && *end == '\0' && n > 0) {
+                storage_.set_scan_workers(n);
+                std::cout << "[MySQLCompat] scan workers " << n << std::endl;
+            }
+        }
+        // 自动清理：空闲时对删改过多的表执行 VACUUM（PCSQL_AUTOVACUUM=0|off|false|no 关闭）
+        if (const char* env = std::getenv("PCSQL_AUTOVACUUM")) {
+            std::string v = to_lower(std::string(env));
+            autovacuum_ = !(v == "0" || v == "off" || v == "false" || v == "no");
+        }
+        if (warmup) storage_.start_warmup();
+        WriterOptions wopts;
+        if (writer_options_from_env(wopts)) {
+            storage_.start_background_writer(wopts);
+            std::cout << "[MySQLCompat] background writer every " << wopts.interval.count()
+                      << " ms, dirty ratio target " << wopts.dirty_ratio_target << std::endl;
+        }
     }
 
     int run(uint16_t port = 3307){
@@ -180,7 +338,7 @@ public:
                 if (errno == EINTR) continue; // interrupted by signal
                 perror("select"); break;
             }
-            if (sel == 0) continue; // timeout, check g_stop again
+            if (sel == 0) { idle_tick(); continue; } // timeout, check g_stop again
             sockaddr_in cli{}; socklen_t cl=sizeof(cli);
             int fd = accept(srv,(sockaddr*)&cli,&cl);
             if(fd<0){
@@ -196,6 +354,19 @@ public:
     }
 
 private:
+    // 空闲（1s 无请求）时运行自动清理：与语句串行执行，不会和扫描/索引维护并发
+    void idle_tick(){
+        if (!autovacuum_) return;
+        try {
+            for (const auto& [tid, st] : storage_.autovacuum()) {
+                std::cout << "[MySQLCompat] autovacuum " << storage_.get_table_name(tid) << ": pages "
+                          << st.pages_before << " -> " << st.pages_after << ", rows moved=" << st.rows_moved << std::endl;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[MySQLCompat] autovacuum failed: " << e.what() << std::endl;
+        }
+    }
+
     void handle_client(int fd){
         uint8_t seq = 0;
         std::cout << "[MySQLCompat] Client connected" << std::endl;
@@ -257,7 +428,7 @@ private:
             timeval tv{}; tv.tv_sec = 1; tv.tv_usec = 0; // 1s tick
             int sel = select(fd+1, &rfds, nullptr, nullptr, &tv);
             if (sel < 0) { if (errno == EINTR) continue; perror("select cmd"); return; }
-            if (sel == 0) continue; // timeout; check g_stop again
+            if (sel == 0) { idle_tick(); continue; } // timeout; check g_stop again
             std::vector<uint8_t> cmdpkt; if(!read_packet(fd, seq, cmdpkt)) return; if(cmdpkt.empty()) return;
             uint8_t cmd = cmdpkt[0];
             std::cout << "[MySQLCompat] Command: 0x" << std::hex << (int)cmd << std::dec << ", payload_len=" << (cmdpkt.size() ? (cmdpkt.size()-1) : 0) << std::endl;
@@ -293,10 +464,14 @@ private:
             // 支持运行时开启/关闭索引跟踪：
             //   SET pcsql_index_trace=ON; / OFF;  (大小写不敏感，支持 1/0/true/false/yes/no)
             //   也兼容 SET @@pcsql_index_trace=1;
+            // 在线调整缓冲池：SET GLOBAL buffer_pool_size = 256M | AUTO; （或 SET @@global.buffer_pool_size=...）
             std::string after = ns.substr(4); // strip leading 'SET '
             after = trim(after);
             while(!after.empty() && after[0]=='@'){ after.erase(after.begin()); }
             after = trim(after);
+            std::string lower_after = to_lower(after);
+            if (lower_after.rfind("global ", 0) == 0) after = trim(after.substr(7));
+            else if (lower_after.rfind("global.", 0) == 0) after = after.substr(7);
             auto pos = after.find('=');
             if (pos != std::string::npos) {
                 std::string key = to_lower(trim(after.substr(0, pos)));
@@ -308,6 +483,22 @@ private:
                     auto ok = make_ok(); if(!write_packet(fd, seq, ok)){ std::cerr << "[MySQLCompat] Failed to send OK for SET index_trace" << std::endl; }
                     return;
                 }
+                if (key == "buffer_pool_size" || key == "pcsql_buffer_pool_size") {
+                    std::size_t frames = 0;
+                    if (!parse_pool_size(val, storage_.page_size(), frames)) {
+                        auto err = make_err(1231, "Invalid buffer_pool_size '" + val + "'"); if(!write_packet(fd, seq, err)){ std::cerr << "[MySQLCompat] Failed to send ERR for SET buffer_pool_size" << std::endl; }
+                        return;
+                    }
+                    try{
+                        storage_.resize_buffer_pool(frames);
+                    }catch(const std::exception& e){
+                        auto err = make_err(1105, e.what()); if(!write_packet(fd, seq, err)){ std::cerr << "[MySQLCompat] Failed to send ERR for SET buffer_pool_size" << std::endl; }
+                        return;
+                    }
+                    std::cout << "[MySQLCompat] buffer pool resized to " << frames << " frames" << std::endl;
+                    auto ok = make_ok(); if(!write_packet(fd, seq, ok)){ std::cerr << "[MySQLCompat] Failed to send OK for SET buffer_pool_size" << std::endl; }
+                    return;
+                }
             }
             auto ok = make_ok(); if(!write_packet(fd, seq, ok)){ std::cerr << "[MySQLCompat] Failed to send OK for SET" << std::endl; } return; }
         if(usql=="select 1" || usql=="select 1;"){
@@ -325,6 +516,14 @@ private:
             std::vector<uint8_t> row = make_text_row({"PcSQL 1.0.0"}); if(!write_packet(fd, seq, row)) { std::cerr << "[MySQLCompat] Failed to send row for version" << std::endl; return; }
             auto eof2 = make_eof(); if(!write_packet(fd, seq, eof2)) { std::cerr << "[MySQLCompat] Failed to send EOF2 for version" << std::endl; } return;
         }
+        if(usql=="show buffer status" || usql=="show buffer pool status"){
+            auto rows = buffer_status_rows(storage_);
+            std::vector<uint8_t> pcols; lenc_int(pcols, 2); if(!write_packet(fd, seq, pcols)) { std::cerr << "[MySQLCompat] Failed to send column-count for SHOW BUFFER STATUS" << std::endl; return; }
+            for (const char* name : {"Variable_name", "Value"}) { auto col = make_coldef("", name, 253); if(!write_packet(fd, seq, col)) { std::cerr << "[MySQLCompat] Failed to send coldef for SHOW BUFFER STATUS" << std::endl; return; } }
+            auto eof = make_eof(); if(!write_packet(fd, seq, eof)) { std::cerr << "[MySQLCompat] Failed to send EOF for SHOW BUFFER STATUS" << std::endl; return; }
+            for (const auto& [k, v] : rows) { auto row = make_text_row({k, v}); if(!write_packet(fd, seq, row)) { std::cerr << "[MySQLCompat] Failed to send row for SHOW BUFFER STATUS" << std::endl; return; } }
+            auto eof2 = make_eof(); if(!write_packet(fd, seq, eof2)) { std::cerr << "[MySQLCompat] Failed to send EOF2 for SHOW BUFFER STATUS" << std::endl; } return;
+        }
         if(usql.rfind("show ",0)==0){ // naive OK to bypass client checks
             auto ok = make_ok(); if(!write_packet(fd, seq, ok)){ std::cerr << "[MySQLCompat] Failed to send OK for SHOW" << std::endl; } return; }
 
@@ -411,7 +610,8 @@ private:
                 for(size_t k=0;k<col_idx.size();++k){ int i = col_idx[k]; int t = mysql_type_from(schema.columns[i].type); auto col = make_coldef(s->fromTable, col_names[k], t); if(!write_packet(fd, seq, col)) { std::cerr << "[MySQLCompat] Failed to send coldef for SELECT" << std::endl; return; } }
                 auto eof = make_eof(); if(!write_packet(fd, seq, eof)) { std::cerr << "[MySQLCompat] Failed to send EOF for SELECT" << std::endl; return; }
                 // rows
-                for(const auto& kv : rows){ auto fields = split(kv.second, '|'); std::vector<std::string> out; out.reserve(col_idx.size()); for(int i : col_idx){ if(i<(int)fields.size()) out.push_back(fields[i]); else out.push_back(""); } auto row = make_text_row(out); if(!write_packet(fd, seq, row)) { std::cerr << "[MySQLCompat] Failed to send row for SELECT" << std::endl; return; } }
+                pcsql::TupleLayout layout(schema);
+                for(const auto& kv : rows){ pcsql::TupleView view(layout, kv.second, &storage_.overflow_store()); std::vector<std::string> out; out.reserve(col_idx.size()); for(int i : col_idx) out.push_back(view.text(i)); auto row = make_text_row(out); if(!write_packet(fd, seq, row)) { std::cerr << "[MySQLCompat] Failed to send row for SELECT" << std::endl; return; } }
                 auto eof2 = make_eof(); if(!write_packet(fd, seq, eof2)) { std::cerr << "[MySQLCompat] Failed to send EOF2 for SELECT" << std::endl; } return;
             }
             // Non-SELECT -> execute and return OK
@@ -430,6 +630,7 @@ private:
 private:
     StorageEngine storage_;
     ExecutionEngine exec_;
+    bool autovacuum_ = true;
 };
 
 int main(int argc, char** argv){
@@ -0,0 +1,339 @@
+#include "storage/async_io.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace pcsql {
+
+// ---------------- IoBatch ----------------
+
+void IoBatch::complete(std::size_t i, int result) {
+    std::lock_guard<std::mutex> lk(mu_);
+    requests_[i].result = result;
+    if (--remaining_ == 0) cv_.notify_all();
+}
+
+bool IoBatch::done() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return remaining_ == 0;
+}
+
+void IoBatch::wait() {
+    std::unique_lock<std::mutex> lk(mu_);
+    cv_.wait(lk, [&]{ return remaining_ == 0; });
+    for (const auto& r : requests_) {
+        if (r.result != 0) {
+            throw std::runtime_error(std::string(r.op == IoRequest::Op::Read ? "async read" : "async write") +
+                                     " of page " + std::to_string(r.page_id) + " failed: " + std::strerror(-r.result));
+        }
+    }
+}
+
+// 同步执行单个请求（线程池后端使用）；返回 0 或 -errno
+static int do_page_io(int fd, IoRequest& r, std::size_t page_size) {
+    char* p = static_cast<char*>(r.buffer);
+    off_t base = static_cast<off_t>(static_cast<std::uint64_t>(r.page_id) * page_size);
+    std::size_t done = 0;
+    while (done < page_size) {
+        ssize_t k = (r.op == IoRequest::Op::Read)
+            ? ::pread(fd, p + done, page_size - done, base + static_cast<off_t>(done))
+            : ::pwrite(fd, p + done, page_size - done, base + static_cast<off_t>(done));
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            return -errno;
+        }
+        if (k == 0) return -EIO; // short read past EOF
+        done += static_cast<std::size_t>(k);
+    }
+    return 0;
+}
+
+// ---------------- Thread-pool backend ----------------
+
+namespace {
+
+class ThreadPoolEngine : public AsyncIoEngine {
+public:
+    ThreadPoolEngine(int fd, std::size_t page_size, std::size_t threads)
+        : fd_(fd), page_size_(page_size) {
+        if (threads == 0) threads = 1;
+        for (std::size_t i = 0; i < threads; ++i) workers_.emplace_back([this]{ run(); });
+    }
+
+    ~ThreadPoolEngine() override {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    std::shared_ptr<IoBatch> submit(std::vector<IoRequest> reqs) override {
+        auto batch = std::make_shared<IoBatch>(std::move(reqs));
+        std::size_t n = batch->requests().size();
+        if (n == 0) return batch;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            for (std::size_t i = 0; i < n; ++i) queue_.push_back(Task{batch, i});
+        }
+        cv_.notify_all();
+        return batch;
+    }
+
+    const char* name() const override { return "threadpool"; }
+
+private:
+    struct Task {
+        std::shared_ptr<IoBatch> batch;
+        std::size_t index;
+    };
+
+    void run() {
+        for (;;) {
+            Task t;
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                cv_.wait(lk, [&]{ return stop_ || !queue_.empty(); });
+                if (queue_.empty()) return; // stop_ and drained
+                t = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            int res = do_page_io(fd_, t.batch->requests()[t.index], page_size_);
+            t.batch->complete(t.index, res);
+        }
+    }
+
+    int fd_;
+    std::size_t page_size_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Task> queue_;
+    bool stop_{false};
+    std::vector<std::thread> workers_;
+};
+
+// ---------------- io_uring backend (raw syscalls, no liburing) ----------------
+
+int sys_io_uring_setup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sys_io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+class IoUringEngine : public AsyncIoEngine {
+public:
+    static std::unique_ptr<IoUringEngine> try_create(int fd, std::size_t page_size, unsigned entries = 64) {
+        std::unique_ptr<IoUringEngine> e(new IoUringEngine(fd, page_size));
+        if (!e->setup(entries)) return nullptr;
+        e->reaper_ = std::thread([raw = e.get()]{ raw->reap_loop(); });
+        return e;
+    }
+
+    ~IoUringEngine() override {
+        if (reaper_.joinable()) {
+            std::unique_lock<std::mutex> lk(mu_);
+            // 等待所有在途请求完成，再投递一个 NOP 唤醒并结束收割线程
+            space_cv_.wait(lk, [&]{ return inflight_ == 0; });
+            stopping_ = true;
+            io_uring_sqe* sqe = next_sqe();
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_NOP;
+            sqe->user_data = 0;
+            commit_sqe();
+            enter_submit();
+            lk.unlock();
+            reaper_.join();
+        }
+        if (sqes_) ::munmap(sqes_, sqes_sz_);
+        if (cq_ptr_ && cq_ptr_ != sq_ptr_) ::munmap(cq_ptr_, cq_sz_);
+        if (sq_ptr_) ::munmap(sq_ptr_, sq_sz_);
+        if (ring_fd_ >= 0) ::close(ring_fd_);
+    }
+
+    std::shared_ptr<IoBatch> submit(std::vector<IoRequest> reqs) override {
+        auto batch = std::make_shared<IoBatch>(std::move(reqs));
+        auto& rs = batch->requests();
+        if (rs.empty()) return batch;
+        std::unique_lock<std::mutex> lk(mu_);
+        for (std::size_t i = 0; i < rs.size(); ++i) {
+            if (inflight_ + pending_ >= entries_) {
+                // 环已满：先把已填好的 SQE 提交出去，再等收割线程腾出位置
+                enter_submit();
+                space_cv_.wait(lk, [&]{ return inflight_ + pending_ < entries_; });
+            }
+            auto* pend = new Pending{batch, i, iovec{rs[i].buffer, page_size_}};
+            io_uring_sqe* sqe = next_sqe();
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = rs[i].op == IoRequest::Op::Read ? IORING_OP_READV : IORING_OP_WRITEV;
+            sqe->fd = fd_;
+            sqe->addr = reinterpret_cast<std::uint64_t>(&pend->iov);
+            sqe->len = 1;
+            sqe->off = static_cast<std::uint64_t>(rs[i].page_id) * page_size_;
+            sqe->user_data = reinterpret_cast<std::uint64_t>(pend);
+            commit_sqe();
+        }
+        enter_submit();
+        return batch;
+    }
+
+    const char* name() const override { return "io_uring"; }
+
+private:
+    struct Pending {
+        std::shared_ptr<IoBatch> batch;
+        std::size_t index;
+        iovec iov;
+    };
+
+    IoUringEngine(int fd, std::size_t page_size) : fd_(fd), page_size_(page_size) {}
+
+    bool setup(unsigned entries) {
+        io_uring_params p{};
+        ring_fd_ = sys_io_uring_setup(entries, &p);
+        if (ring_fd_ < 0) return false;
+        entries_ = p.sq_entries;
+
+        sq_sz_ = p.sq_off.array + p.sq_entries * sizeof(std::uint32_t);
+        cq_sz_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) sq_sz_ = cq_sz_ = std::max(sq_sz_, cq_sz_);
+
+        sq_ptr_ = ::mmap(nullptr, sq_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) { sq_ptr_ = nullptr; return false; }
+        if (single) {
+            cq_ptr_ = sq_ptr_;
+        } else {
+            cq_ptr_ = ::mmap(nullptr, cq_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+            if (cq_ptr_ == MAP_FAILED) { cq_ptr_ = nullptr; return false; }
+        }
+        sqes_sz_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqes_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<char*>(sq_ptr_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        auto* cq = static_cast<char*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        local_tail_ = *sq_tail_;
+        return true;
+    }
+
+    // caller holds mu_
+    io_uring_sqe* next_sqe() {
+        unsigned idx = local_tail_ & sq_mask_;
+        sq_array_[idx] = idx;
+        return &sqes_[idx];
+    }
+
+    // caller holds mu_
+    void commit_sqe() {
+        ++local_tail_;
+        ++pending_;
+        __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+    }
+
+    // caller holds mu_
+    void enter_submit() {
+        while (pending_ > 0) {
+            int rc = sys_io_uring_enter(ring_fd_, pending_, 0, 0);
+            if (rc < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+                throw std::runtime_error(std::string("io_uring_enter(submit) failed: ") + std::strerror(errno));
+            }
+            pending_ -= static_cast<unsigned>(rc);
+            inflight_ += static_cast<unsigned>(rc);
+        }
+    }
+
+    void reap_loop() {
+        for (;;) {
+            int rc = sys_io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+            if (rc < 0 && errno != EINTR && errno != EAGAIN) return;
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            bool stop = false;
+            unsigned reaped = 0;
+            while (head != tail) {
+                const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                if (cqe.user_data == 0) {
+                    stop = true;
+                } else {
+                    auto* pend = reinterpret_cast<Pending*>(cqe.user_data);
+                    int res = cqe.res < 0 ? cqe.res
+                            : (static_cast<std::size_t>(cqe.res) == page_size_ ? 0 : -EIO);
+                    pend->batch->complete(pend->index, res);
+                    delete pend;
+                    ++reaped;
+                }
+                ++head;
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+            if (reaped > 0) {
+                std::lock_guard<std::mutex> lk(mu_);
+                inflight_ -= reaped;
+                space_cv_.notify_all();
+            }
+            if (stop) return;
+        }
+    }
+
+    int fd_;
+    std::size_t page_size_;
+    int ring_fd_{-1};
+    unsigned entries_{0};
+
+    void* sq_ptr_{nullptr};
+    void* cq_ptr_{nullptr};
+    std::size_t sq_sz_{0}, cq_sz_{0}, sqes_sz_{0};
+    io_uring_sqe* sqes_{nullptr};
+    unsigned* sq_tail_{nullptr};
+    unsigned* sq_array_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned* cq_head_{nullptr};
+    unsigned* cq_tail_{nullptr};
+    unsigned cq_mask_{0};
+    io_uring_cqe* cqes_{nullptr};
+
+    std::mutex mu_;                   // guards SQ ring and counters
+    std::condition_variable space_cv_;
+    unsigned local_tail_{0};
+    unsigned pending_{0};             // filled but not yet submitted
+    unsigned inflight_{0};            // submitted, completion not yet reaped
+    bool stopping_{false};
+    std::thread reaper_;
+};
+
+} // namespace
+
+std::unique_ptr<AsyncIoEngine> AsyncIoEngine::create(int fd, std::size_t page_size,
+                                                     IoBackend backend, std::size_t threads) {
+    if (backend != IoBackend::ThreadPool) {
+        if (auto ring = IoUringEngine::try_create(fd, page_size)) return ring;
+        if (backend == IoBackend::IoUring) {
+            throw std::runtime_error("io_uring backend requested but io_uring_setup is unavailable");
+        }
+    }
+    return std::make_unique<ThreadPoolEngine>(fd, page_size, threads);
+}
+
+} // namespace pcsql
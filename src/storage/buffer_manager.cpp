@@ -1,92 +1,983 @@
 #include "storage/buffer_manager.hpp"
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 #include <stdexcept>
 #include <cstring>
+#include <sstream>
+#include <thread>
+
+#include <sys/mman.h>
+#include <unistd.h>
 
 namespace pcsql {
 
+BufferManager::Chunk::Chunk(std::size_t page_size)
+    : frames(std::make_unique<Frame[]>(CHUNK_FRAMES)), bytes(CHUNK_FRAMES * page_size) {
+    // 匿名映射：按需分配物理页，收缩时可用 MADV_DONTNEED 逐帧归还；页对齐满足 O_DIRECT
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+    arena = static_cast<char*>(p);
+    for (std::size_t i = 0; i < CHUNK_FRAMES; ++i) frames[i].page.data = PageData(arena + i * page_size, page_size);
+}
+
+BufferManager::Chunk::~Chunk() {
+    if (arena) ::munmap(arena, bytes);
+}
+
 BufferManager::BufferManager(DiskManager& disk, std::size_t capacity, Policy policy, bool enable_logging)
-    : disk_(disk), capacity_(capacity), policy_(policy), enable_logging_(enable_logging) {
-    if (capacity_ == 0) throw std::invalid_argument("capacity must be > 0");
-    frames_.resize(capacity_);
-    used_.assign(capacity_, false);
-    for (std::size_t i = 0; i < capacity_; ++i) free_list_.push_back(i);
-}
-
-Page& BufferManager::get_page(std::uint32_t page_id) {
-    auto it = page_table_.find(page_id);
-    if (it != page_table_.end()) {//如果没找到：it 等于 page_table_.end()
-        // hit
-        stats_.hits++;//命中数+1
-        std::size_t idx = it->second;
-        Frame& f = frames_[idx];
-        f.pin_count++;
-        // LRU: 从替换队列移除，稍后在unpin时按最近使用重新入队；
-        // FIFO: 保持原入队顺序，不做改变
-        if (policy_ == Policy::LRU) {
-            auto itpos = repl_pos_.find(idx);
-            if (itpos != repl_pos_.end()) {
-                repl_list_.erase(itpos->second);
-                repl_pos_.erase(itpos);
+    : disk_(disk), capacity_(capacity), policy_(policy), enable_logging_(enable_logging),
+      page_size_(disk.page_size()) {
+    if (capacity == 0) throw std::invalid_argument("capacity must be > 0");
+    if (capacity > MAX_CAPACITY) throw std::invalid_argument("capacity exceeds MAX_CAPACITY");
+    // 帧按块分配，页大小取自磁盘文件的超级块
+    chunks_ = std::make_unique<std::atomic<Chunk*>[]>(MAX_CHUNKS);
+    for (std::size_t c = 0; c < MAX_CHUNKS; ++c) chunks_[c].store(nullptr, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> pl(pool_mu_);
+    add_frames(capacity);
+    for (std::size_t i = 0; i < capacity; ++i) {
+        frame(i).retired = false;
+        free_list_.push_back(i);
+    }
+    set_policy_limits();
+}
+
+BufferManager::~BufferManager() {
+    stop_warmup();
+    stop_background_writer();
+    std::size_t chunks = frame_limit_.load() / CHUNK_FRAMES;
+    for (std::size_t c = 0; c < chunks; ++c) delete chunks_[c].load();
+}
+
+Stats BufferManager::stats() const {
+    Stats s;
+    s.hits = stats_.hits.load();
+    s.misses = stats_.misses.load();
+    s.evictions = stats_.evictions.load();
+    s.flushes = stats_.flushes.load();
+    s.background_flushes = stats_.background_flushes.load();
+    s.dirty_evictions = stats_.dirty_evictions.load();
+    s.readahead_hits = stats_.readahead_hits.load();
+    s.prewarmed = stats_.prewarmed.load();
+    return s;
+}
+
+BufferStatus BufferManager::status() {
+    BufferStatus st;
+    st.totals = stats();
+    st.capacity = capacity();
+    for (auto& sh : shards_) {
+        std::lock_guard<std::mutex> lk(sh.mu);
+        st.resident += sh.table.size();
+        for (std::size_t k = 0; k < PAGE_KIND_COUNT; ++k) {
+            st.by_kind[k].hits += sh.kind_counters[k].hits;
+            st.by_kind[k].misses += sh.kind_counters[k].misses;
+            st.by_kind[k].evictions += sh.kind_counters[k].evictions;
+        }
+        for (const auto& [tid, c] : sh.table_counters) {
+            auto& t = st.by_table[tid];
+            t.hits += c.hits;
+            t.misses += c.misses;
+            t.evictions += c.evictions;
+        }
+    }
+    st.dirty = dirty_pages();
+    for (std::size_t b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+        st.miss_latency.buckets[b] = miss_latency_[b].load(std::memory_order_relaxed);
+        st.miss_latency.count += st.miss_latency.buckets[b];
+    }
+    st.miss_latency.total_us = miss_latency_us_.load(std::memory_order_relaxed);
+    return st;
+}
+
+void BufferManager::tag_page(std::uint32_t page_id, PageKind kind, std::int32_t table_id) {
+    Shard& sh = shard_of(page_id);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    if (kind == PageKind::Unknown) {
+        sh.tags.erase(page_id);
+        table_id = -1;
+    } else {
+        sh.tags[page_id] = PageTag{kind, table_id};
+    }
+    auto it = sh.table.find(page_id);
+    if (it == sh.table.end()) return;
+    Page& p = frame(it->second).page;
+    p.kind.store(kind, std::memory_order_relaxed);
+    p.owner.store(table_id, std::memory_order_relaxed);
+}
+
+void BufferManager::discard_page(std::uint32_t page_id) {
+    Shard& sh = shard_of(page_id);
+    std::unique_lock<std::mutex> lk(sh.mu);
+    auto it = sh.table.find(page_id);
+    // 正在装载或为驱逐写回的帧：放开分片锁等 I/O 结束（I/O 线程结束时要重新拿分片锁）
+    while (it != sh.table.end() && frame(it->second).busy.load()) {
+        Frame& busy = frame(it->second);
+        lk.unlock();
+        { std::shared_lock<std::shared_mutex> wait(busy.page.latch); }
+        lk.lock();
+        it = sh.table.find(page_id);
+    }
+    sh.tags.erase(page_id);
+    // 使此前发起的预读/预热副本失效（保持偶数：没有写回在进行）
+    write_epoch(page_id) += 2;
+    if (it == sh.table.end()) return;
+    Frame& f = frame(it->second);
+    if (f.pin_count.load() != 0) throw std::logic_error("discard_page: page " + std::to_string(page_id) + " is pinned");
+    // 原地清零而不是移出页表：帧可能在扫描环中，替换状态保持不变；磁盘上的旧内容在页被复用时清零。
+    // 未 pin 的帧只有刷盘者持共享页闩，它们不会在持有页闩时等待分片锁，这里可以阻塞等待
+    std::unique_lock<std::shared_mutex> latch(f.page.latch);
+    std::memset(f.page.data.data(), 0, page_size_);
+    f.dirty = false;
+    f.page.kind.store(PageKind::Unknown, std::memory_order_relaxed);
+    f.page.owner.store(-1, std::memory_order_relaxed);
+}
+
+Page& BufferManager::get_page(std::uint32_t page_id, ScanContext& scan) {
+    if (&scan.buffer_ != this) throw std::invalid_argument("scan context belongs to another buffer pool");
+    scan_advance(scan, page_id); // 在加分片锁之前等待/发起预读
+    return fetch(page_id, &scan);
+}
+
+Page& BufferManager::fetch(std::uint32_t page_id, ScanContext* scan) {
+    Shard& sh = shard_of(page_id);
+    for (;;) {
+        std::unique_lock<std::mutex> lk(sh.mu);
+        auto it = sh.table.find(page_id);
+        if (it != sh.table.end()) {//如果没找到：it 等于 table.end()
+            // hit（命中/未命中在结果确定时才计数：等待后重试的访问只计一次）
+            std::size_t idx = it->second;
+            Frame& f = frame(idx);
+            f.pin_count++;
+            // 所有策略都递增使用计数：CLOCK 据此选受害帧，扫描环据此不回收被再次访问过的帧
+            touch_clock(f);
+            // LRU: 从替换队列移除，稍后在unpin时按最近使用重新入队；
+            // FIFO: 保持原入队顺序，不做改变
+            // CLOCK: 只递增使用计数，不加 pool_mu_、不分配内存
+            // 2Q: Am 中的页移到 MRU 端；A1in 中的页不动（短时间内的相关访问不算热）
+            if (policy_ == Policy::TWO_Q) {
+                std::lock_guard<std::mutex> pl(pool_mu_);
+                two_q_touch(idx);
+            } else if (policy_ == Policy::LRU) {
+                std::lock_guard<std::mutex> pl(pool_mu_);
+                auto itpos = repl_pos_.find(idx);
+                if (itpos != repl_pos_.end()) {
+                    repl_list_.erase(itpos->second);
+                    repl_pos_.erase(itpos);
+                }
+            }
+            if (!f.busy.load()) {
+                stats_.hits++;//命中数+1
+                count(sh, f.page, &PageCounters::hits);
+                log("HIT page ", page_id, " -> frame ", idx);
+                return f.page;
             }
+            // 帧正在装载或为驱逐写回：已 pin 住，放开分片锁在页闩上等 I/O 结束，再确认映射仍在
+            lk.unlock();
+            { std::shared_lock<std::shared_mutex> wait(f.page.latch); }
+            lk.lock();
+            it = sh.table.find(page_id);
+            if (it != sh.table.end() && it->second == idx) {
+                stats_.hits++;
+                count(sh, f.page, &PageCounters::hits);
+                log("HIT page ", page_id, " -> frame ", idx, " after I/O");
+                return f.page;
+            }
+            // 装载失败，映射已撤销：最后一个放手的归还帧，然后重试
+            if (--f.pin_count == 0) {
+                std::lock_guard<std::mutex> pl(pool_mu_);
+                release_frame(idx);
+            }
+            continue;
+        }
+        lk.unlock();
+
+        // Need a free frame or evict one。不持有分片锁：受害页的写回不阻塞本分片的其他页
+        std::size_t idx = acquire_frame(scan);//被选帧已 pin，且不在任何页表中
+        Frame& f = frame(idx);
+        std::unique_lock<std::shared_mutex> latch(f.page.latch);
+        lk.lock();
+        if (sh.table.count(page_id)) {
+            // 其他线程已先装入该页：交还帧，按命中处理
+            lk.unlock();
+            latch.unlock();
+            std::lock_guard<std::mutex> pl(pool_mu_);
+            if (scan) leave_ring(*scan, idx);
+            release_frame(idx);
+            continue;
+        }
+        // 以“装载中”状态登记到页表（pin 住并持独占页闩），放开分片锁后再读盘；同页的并发访问在页闩上等待
+        f.page.page_id = page_id;
+        auto tag = sh.tags.find(page_id);
+        f.page.kind.store(tag != sh.tags.end() ? tag->second.kind : PageKind::Unknown, std::memory_order_relaxed);
+        f.page.owner.store(tag != sh.tags.end() ? tag->second.owner : -1, std::memory_order_relaxed);
+        stats_.misses++;//未命中
+        count(sh, f.page, &PageCounters::misses);
+        f.dirty = false;
+        f.usage = 1;
+        f.busy = true;
+        f.resident = true;
+        sh.table[page_id] = idx;//填充页表
+        lk.unlock();
+
+        // load from disk（扫描时优先用预读好的副本）
+        auto started = std::chrono::steady_clock::now();
+        try {
+            if (scan && take_staged(*scan, page_id, f.page.data.data())) {
+                stats_.readahead_hits++;
+            } else {
+                disk_.read_page(page_id, f.page.data.data());
+            }
+        } catch (...) {
+            lk.lock();
+            sh.table.erase(page_id);
+            f.resident = false;
+            f.busy = false;
+            std::lock_guard<std::mutex> pl(pool_mu_);
+            if (scan) leave_ring(*scan, idx);
+            // 等待者各自持有 pin：最后一个放手的归还帧（装载期间缓冲池被收缩则退役）
+            if (--f.pin_count == 0) release_frame(idx);
+            throw;
         }
-        log("HIT page " + std::to_string(page_id) + " -> frame " + std::to_string(idx));
-        return f.page;
+        record_miss_latency(std::chrono::steady_clock::now() - started);
+        if (policy_ == Policy::TWO_Q && !scan) { // 环帧不进入 2Q 队列
+            std::lock_guard<std::mutex> pl(pool_mu_);
+            two_q_admit(idx, page_id);
+        }
+        f.busy = false;
+        log("MISS load page ", page_id, " into frame ", idx);
+        return f.page; // pinned by caller；返回时放开页闩，唤醒等待者
     }
+}
 
-    stats_.misses++;//未命中
-    // Need a free frame or evict one
-    std::size_t idx;//被选frame索引
-    if (!free_list_.empty()) {//有空闲frame
-        idx = free_list_.back();
-        free_list_.pop_back();
+void BufferManager::leave_ring(ScanContext& scan, std::size_t idx) {
+    Frame& f = frame(idx);
+    if (!f.in_ring) return;
+    auto& ring = scan.ring_;
+    ring.erase(std::find(ring.begin(), ring.end(), idx));
+    if (scan.ring_next_ >= ring.size()) scan.ring_next_ = 0;
+    f.in_ring = false;
+}
+
+void BufferManager::release_frame(std::size_t idx) {
+    Frame& f = frame(idx);
+    if (idx >= capacity_) {
+        retire_frame(idx);
     } else {
-        idx = pick_victim();//选择一个frame
+        f.pin_count = 0;
+        free_list_.push_back(idx);
     }
+}
 
-    Frame& f = frames_[idx];
-    if (used_[idx]) {
-        // evict existing page
+std::size_t BufferManager::acquire_frame(ScanContext* scan) {
+    for (;;) {
+        std::unique_lock<std::mutex> pl(pool_mu_);
+        std::size_t idx = 0;
+        bool contended = false;
+        std::unique_lock<std::mutex> vl;
+        std::unique_lock<std::shared_mutex> latch;
+        bool found = false;
+        bool from_ring = false;
+        if (scan && !scan->ring_.empty() && scan->ring_.size() >= scan->ring_size_) {
+            // 环已满：回收环中下一帧；它若正被别人 pin/访问（变热了），交还共享池，本次改从共享池取帧
+            std::size_t cand = scan->ring_[scan->ring_next_];
+            bool hot = frame(cand).usage.load(std::memory_order_relaxed) > 1;
+            // 缓冲池收缩后超出容量的环帧也交还共享池，由驱逐路径退役
+            if (!hot && cand < capacity_ && try_claim(cand, vl, latch, contended)) {
+                idx = cand;
+                found = from_ring = true;
+                scan->ring_next_ = (scan->ring_next_ + 1) % scan->ring_.size();
+            } else {
+                scan->ring_.erase(scan->ring_.begin() + static_cast<std::ptrdiff_t>(scan->ring_next_));
+                if (scan->ring_next_ >= scan->ring_.size()) scan->ring_next_ = 0;
+                demote_ring_frame(cand, true);
+                contended = false;
+            }
+        }
+        if (!found && !free_list_.empty()) {//有空闲frame
+            idx = free_list_.back();
+            free_list_.pop_back();
+            frame(idx).pin_count = 1;
+            if (scan) { frame(idx).in_ring = true; scan->ring_.push_back(idx); }
+            return idx;
+        }
+
+        // 已持有 pool_mu_，对受害页所在分片与页闩只能 try_lock（避免与 shard->pool 顺序死锁）
+        if (!found) {
+            found = policy_ == Policy::CLOCK ? pick_clock(idx, vl, latch, contended)
+                  : policy_ == Policy::TWO_Q ? pick_two_q(idx, vl, latch, contended)
+                                             : pick_from_list(idx, vl, latch, contended);
+        }
+        if (!found) {
+            if (!contended) throw std::runtime_error("No frame available for eviction (all pinned)");
+            pl.unlock();
+            std::this_thread::yield();
+            continue;
+        }
+        Frame& f = frame(idx);
+        Shard& vs = shard_of(f.page.page_id);
+        f.pin_count = 1;
+        bool retiring = idx >= capacity_;
+        if (scan && !from_ring && !retiring) { f.in_ring = true; scan->ring_.push_back(idx); }
+        pl.unlock();
+
+        // evict existing page：脏页写回期间受害页仍留在页表中（pin 住并持独占页闩），写回完成前其他线程无法
+        // 重新装载该页；放开受害页分片锁，同分片的其他页照常访问，访问受害页的线程在页闩上等待
         if (f.dirty) {
-            disk_.write_page(f.page.page_id, f.page.data.data());//若脏页，写回磁盘
+            std::uint32_t victim = f.page.page_id;
+            f.busy = true;
+            vl.unlock();
+            // 写回失败或期间又被访问：放弃驱逐，帧留在原处交还替换策略
+            auto abandon = [&] {
+                f.busy = false;
+                std::lock_guard<std::mutex> relock(pool_mu_);
+                if (scan) leave_ring(*scan, idx);
+                if (policy_ == Policy::TWO_Q) {
+                    am_.push_back(idx);
+                    q_where_[idx] = TwoQQueue::Am;
+                    q_pos_[idx] = std::prev(am_.end());
+                }
+                if (--f.pin_count == 0 && policy_ != Policy::CLOCK && policy_ != Policy::TWO_Q) on_unpinned(idx);
+            };
+            write_epoch(victim)++;
+            try {
+                disk_.write_page(victim, f.page.data.data());//若脏页，写回磁盘
+            } catch (...) {
+                write_epoch(victim)++;
+                vl.lock();
+                abandon();
+                throw;
+            }
+            write_epoch(victim)++;
+            f.dirty = false;
             stats_.flushes++;
-            log("FLUSH dirty page " + std::to_string(f.page.page_id) + " before eviction");
+            stats_.dirty_evictions++;
+            // 读者承担了写延迟：提前唤醒后台写线程
+            if (!writer_kick_.exchange(true)) writer_cv_.notify_one();
+            log("FLUSH dirty page ", victim, " before eviction");
+            // 持独占页闩时可以阻塞等分片锁：持分片锁等页闩的只有 discard_page，且只等未 pin 的帧
+            vl.lock();
+            if (f.pin_count.load() != 1) {
+                abandon();
+                continue;
+            }
+            f.busy = false;
         }
-        log("EVICT page " + std::to_string(f.page.page_id) + " from frame " + std::to_string(idx));
-        page_table_.erase(f.page.page_id);//删除 page_table_ 中的旧映射
+        log("EVICT page ", f.page.page_id, " from frame ", idx);
+        vs.table.erase(f.page.page_id);//删除页表中的旧映射
+        count(vs, f.page, &PageCounters::evictions);
+        f.resident = false;
         stats_.evictions++;
-        // also remove from replacement structures if exists
-        auto itpos = repl_pos_.find(idx);
-        if (itpos != repl_pos_.end()) {
-            repl_list_.erase(itpos->second);
-            repl_pos_.erase(itpos);
-        }//删除替换队列中的旧映射
+        if (retiring) {
+            // 受害帧在收缩后的容量之外：退役后重新取帧（期间若又扩容则照常使用）
+            std::lock_guard<std::mutex> relock(pool_mu_);
+            if (idx >= capacity_) {
+                retire_frame(idx);
+                continue;
+            }
+        }
+        return idx;
     }
+}
+
+void BufferManager::demote_ring_frame(std::size_t frame_idx, bool hot) {
+    Frame& f = frame(frame_idx);
+    f.in_ring = false;
+    if (!f.resident.load()) return;
+    switch (policy_) {
+        case Policy::CLOCK:
+            if (!hot) f.usage = 0;
+            break;
+        case Policy::TWO_Q: {
+            auto& q = hot ? am_ : a1in_;
+            auto pos = hot ? q.insert(q.end(), frame_idx) : q.insert(q.begin(), frame_idx);
+            q_where_[frame_idx] = hot ? TwoQQueue::Am : TwoQQueue::A1in;
+            q_pos_[frame_idx] = pos;
+            break;
+        }
+        default:
+            // 仍被 pin 的帧等 unpin 时由 on_unpinned 入队
+            if (f.pin_count.load() != 0 || repl_pos_.count(frame_idx)) break;
+            repl_pos_[frame_idx] = hot ? repl_list_.insert(repl_list_.end(), frame_idx)
+                                       : repl_list_.insert(repl_list_.begin(), frame_idx);
+            break;
+    }
+}
+
+bool BufferManager::try_claim(std::size_t idx, std::unique_lock<std::mutex>& vl,
+                              std::unique_lock<std::shared_mutex>& latch, bool& contended) {
+    Frame& f = frame(idx);
+    std::unique_lock<std::mutex> sl(shard_of(f.page.page_id).mu, std::try_to_lock);
+    if (!sl.owns_lock()) { contended = true; return false; }
+    // 命中路径先在分片锁下加 pin 再更新替换状态，这里可能看到已被重新 pin 的帧
+    if (f.pin_count.load() != 0) return false;
+    // 正在被刷盘（持有共享页闩）的帧暂不驱逐
+    std::unique_lock<std::shared_mutex> ll(f.page.latch, std::try_to_lock);
+    if (!ll.owns_lock()) { contended = true; return false; }
+    vl = std::move(sl);
+    latch = std::move(ll);
+    return true;
+}
+
+bool BufferManager::pick_from_list(std::size_t& idx, std::unique_lock<std::mutex>& vl,
+                                   std::unique_lock<std::shared_mutex>& latch, bool& contended) {
+    // Victim from front of list
+    for (auto it = repl_list_.begin(); it != repl_list_.end(); ++it) {
+        if (!try_claim(*it, vl, latch, contended)) continue;
+        idx = *it;
+        repl_list_.erase(it);
+        repl_pos_.erase(idx);
+        return true;
+    }
+    return false;
+}
+
+bool BufferManager::pick_two_q(std::size_t& idx, std::unique_lock<std::mutex>& vl,
+                               std::unique_lock<std::shared_mutex>& latch, bool& contended) {
+    auto take = [&](std::list<std::size_t>& q) {
+        for (auto it = q.begin(); it != q.end(); ++it) {
+            if (!try_claim(*it, vl, latch, contended)) continue;
+            idx = *it;
+            bool from_a1in = q_where_[idx] == TwoQQueue::A1in;
+            q.erase(it);
+            q_where_[idx] = TwoQQueue::None;
+            // 从 A1in 淘汰的页记入幽灵队列：若很快再被访问，说明它是热页，直接进入 Am
+            if (from_a1in) two_q_remember(frame(idx).page.page_id);
+            return true;
+        }
+        return false;
+    };
+    // A1in 超过 Kin 时优先淘汰 A1in（扫描页在这里打转），否则淘汰 Am 的 LRU 端
+    if (a1in_.size() > a1in_target_) return take(a1in_) || take(am_);
+    return take(am_) || take(a1in_);
+}
+
+void BufferManager::two_q_admit(std::size_t frame_idx, std::uint32_t page_id) {
+    auto ghost = a1out_pos_.find(page_id);
+    if (ghost != a1out_pos_.end()) {
+        a1out_.erase(ghost->second);
+        a1out_pos_.erase(ghost);
+        am_.push_back(frame_idx);
+        q_where_[frame_idx] = TwoQQueue::Am;
+        q_pos_[frame_idx] = std::prev(am_.end());
+    } else {
+        a1in_.push_back(frame_idx);
+        q_where_[frame_idx] = TwoQQueue::A1in;
+        q_pos_[frame_idx] = std::prev(a1in_.end());
+    }
+}
+
+void BufferManager::two_q_touch(std::size_t frame_idx) {
+    if (q_where_[frame_idx] != TwoQQueue::Am) return;
+    am_.splice(am_.end(), am_, q_pos_[frame_idx]); // 迭代器保持有效，无需分配
+}
 
-    // load from disk
+void BufferManager::two_q_remember(std::uint32_t page_id) {
+    if (a1out_pos_.count(page_id)) return;
+    a1out_.push_back(page_id);
+    a1out_pos_[page_id] = std::prev(a1out_.end());
+    if (a1out_.size() > a1out_limit_) {
+        a1out_pos_.erase(a1out_.front());
+        a1out_.pop_front();
+    }
+}
+
+bool BufferManager::pick_clock(std::size_t& idx, std::unique_lock<std::mutex>& vl,
+                               std::unique_lock<std::shared_mutex>& latch, bool& contended) {
+    // 指针循环扫过所有帧：被 pin 的跳过；使用计数 > 0 的减一后放过；计数为 0 的即为受害者。
+    // 最多扫 (CLOCK_MAX_USAGE + 1) 圈，足以把任何未 pin 帧的计数减到 0
+    // 指针走过全部帧（含收缩后尚未退役的帧），退役帧不常驻，直接跳过
+    const std::size_t limit = frame_limit_.load();
+    const std::size_t max_steps = limit * (CLOCK_MAX_USAGE + 2);
+    for (std::size_t step = 0; step < max_steps; ++step) {
+        std::size_t i = clock_hand_;
+        clock_hand_ = (clock_hand_ + 1) % limit;
+        Frame& f = frame(i);
+        if (!f.resident.load() || f.in_ring || f.pin_count.load() != 0) continue;
+        std::uint8_t u = f.usage.load(std::memory_order_relaxed);
+        if (u > 0) {
+            f.usage.compare_exchange_strong(u, static_cast<std::uint8_t>(u - 1), std::memory_order_relaxed);
+            continue;
+        }
+        if (!try_claim(i, vl, latch, contended)) continue;
+        idx = i;
+        return true;
+    }
+    return false;
+}
+
+// ---------------- Resize ----------------
+
+void BufferManager::add_frames(std::size_t frames) {
+    std::size_t have = frame_limit_.load();
+    if (frames <= have) return;
+    std::size_t chunks = (frames + CHUNK_FRAMES - 1) / CHUNK_FRAMES;
+    for (std::size_t c = have / CHUNK_FRAMES; c < chunks; ++c) {
+        chunks_[c].store(new Chunk(page_size_), std::memory_order_release);
+    }
+    // 新帧先处于退役状态，由调用方放入空闲链表
+    std::size_t limit = chunks * CHUNK_FRAMES;
+    for (std::size_t i = have; i < limit; ++i) frame(i).retired = true;
+    if (policy_ == Policy::TWO_Q) {
+        q_where_.resize(limit, TwoQQueue::None);
+        q_pos_.resize(limit);
+    }
+    frame_limit_.store(limit);
+}
+
+void BufferManager::retire_frame(std::size_t idx) {
+    Frame& f = frame(idx);
+    f.retired = true;
+    f.pin_count = 0;
+    f.usage = 0;
+    f.dirty = false;
+    // 归还物理内存；映射保留，再次扩容时按需重新分配（读到全零页）
+    static const std::size_t os_page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    if (page_size_ % os_page == 0) ::madvise(f.page.data.data(), page_size_, MADV_DONTNEED);
+}
+
+void BufferManager::remove_from_policy(std::size_t idx) {
+    if (policy_ == Policy::TWO_Q) {
+        if (q_where_[idx] == TwoQQueue::None) return;
+        (q_where_[idx] == TwoQQueue::A1in ? a1in_ : am_).erase(q_pos_[idx]);
+        q_where_[idx] = TwoQQueue::None;
+    } else if (policy_ != Policy::CLOCK) {
+        auto it = repl_pos_.find(idx);
+        if (it == repl_pos_.end()) return;
+        repl_list_.erase(it->second);
+        repl_pos_.erase(it);
+    }
+}
+
+void BufferManager::set_policy_limits() {
+    if (policy_ != Policy::TWO_Q) return;
+    // 2Q 论文建议 Kin ≈ 25%、Kout ≈ 50% 的缓冲池大小
+    a1in_target_ = std::max<std::size_t>(1, capacity_ / 4);
+    a1out_limit_ = std::max<std::size_t>(1, capacity_ / 2);
+    while (a1out_.size() > a1out_limit_) {
+        a1out_pos_.erase(a1out_.front());
+        a1out_.pop_front();
+    }
+}
+
+bool BufferManager::drain_frame(std::uint32_t page_id, std::size_t idx) {
+    // 与驱逐相同：持有分片锁期间无人能 pin 该页，独占页闩保证没有读写者
+    Shard& sh = shard_of(page_id);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    auto it = sh.table.find(page_id);
+    if (it == sh.table.end() || it->second != idx) return true; // 已被驱逐
+    Frame& f = frame(idx);
+    if (f.pin_count.load() != 0) return false;
+    std::unique_lock<std::shared_mutex> latch(f.page.latch, std::try_to_lock);
+    if (!latch.owns_lock()) return false;
+    {
+        std::lock_guard<std::mutex> pl(pool_mu_);
+        if (f.in_ring) return false; // 由扫描交还共享池后再处理
+    }
+    if (f.dirty) {
+        write_epoch(page_id)++;
+        try {
+            disk_.write_page(page_id, f.page.data.data());
+        } catch (...) {
+            write_epoch(page_id)++;
+            throw;
+        }
+        write_epoch(page_id)++;
+        f.dirty = false;
+        stats_.flushes++;
+    }
+    log("EVICT page ", page_id, " from retiring frame ", idx);
+    sh.table.erase(it);
+    count(sh, f.page, &PageCounters::evictions);
+    f.resident = false;
+    stats_.evictions++;
+    std::lock_guard<std::mutex> pl(pool_mu_);
+    remove_from_policy(idx);
+    retire_frame(idx);
+    return true;
+}
+
+void BufferManager::resize(std::size_t new_capacity, std::chrono::milliseconds timeout) {
+    if (new_capacity == 0) throw std::invalid_argument("capacity must be > 0");
+    if (new_capacity > MAX_CAPACITY) throw std::invalid_argument("capacity exceeds MAX_CAPACITY");
+    std::lock_guard<std::mutex> rl(resize_mu_);
+    {
+        std::lock_guard<std::mutex> pl(pool_mu_);
+        std::size_t old = capacity_;
+        if (new_capacity > old) {
+            // 扩容：新增的块与之前退役的帧进入空闲链表；仍在排空中的帧直接恢复为正常帧
+            add_frames(new_capacity);
+            for (std::size_t i = old; i < new_capacity; ++i) {
+                Frame& f = frame(i);
+                if (f.retired) {
+                    f.retired = false;
+                    free_list_.push_back(i);
+                }
+            }
+            capacity_ = new_capacity;
+            set_policy_limits();
+            log("RESIZE buffer pool ", old, " -> ", new_capacity, " frames");
+            return;
+        }
+        // 收缩（或以相同大小重试上次超时的收缩）：先降容量，此后不再有新页装入超出容量的帧；空闲帧立即退役
+        capacity_ = new_capacity;
+        set_policy_limits();
+        auto keep = std::remove_if(free_list_.begin(), free_list_.end(), [&](std::size_t idx) {
+            if (idx < new_capacity) return false;
+            retire_frame(idx);
+            return true;
+        });
+        free_list_.erase(keep, free_list_.end());
+        if (new_capacity < old) log("RESIZE buffer pool ", old, " -> ", new_capacity, " frames");
+    }
+    // 常驻于超出容量的帧中的页逐个驱逐（脏页先写回）；被 pin 的页等待其释放
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        std::vector<std::pair<std::uint32_t, std::size_t>> left;
+        for (auto& sh : shards_) {
+            std::lock_guard<std::mutex> lk(sh.mu);
+            for (const auto& [pid, idx] : sh.table) {
+                if (idx >= new_capacity) left.emplace_back(pid, idx);
+            }
+        }
+        std::size_t busy = 0;
+        for (const auto& [pid, idx] : left) {
+            if (!drain_frame(pid, idx)) ++busy;
+        }
+        if (busy == 0) return;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            throw std::runtime_error("buffer pool shrink timed out: " + std::to_string(busy) +
+                                     " frames still in use (they are retired once evicted)");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+std::optional<std::size_t> BufferManager::cgroup_memory_limit() {
+    // "max" 或极大值（cgroup v1 的无限制）视为没有限制
+    auto read_limit = [](const std::string& path) -> std::optional<std::size_t> {
+        std::ifstream ifs(path);
+        std::string v;
+        if (!(ifs >> v) || v == "max") return std::nullopt;
+        try {
+            unsigned long long n = std::stoull(v);
+            if (n == 0 || n >= (1ULL << 60)) return std::nullopt;
+            return static_cast<std::size_t>(n);
+        } catch (const std::exception&) {
+            return std::nullopt;
+        }
+    };
+    // /proc/self/cgroup："0::/path"（v2）或 "N:...memory...:/path"（v1）
+    std::ifstream ifs("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(ifs, line)) {
+        auto c1 = line.find(':');
+        auto c2 = c1 == std::string::npos ? std::string::npos : line.find(':', c1 + 1);
+        if (c2 == std::string::npos) continue;
+        std::string controllers = line.substr(c1 + 1, c2 - c1 - 1);
+        std::string path = line.substr(c2 + 1);
+        if (path == "/") path.clear();
+        if (line.compare(0, c1, "0") == 0 && controllers.empty()) {
+            if (auto lim = read_limit("/sys/fs/cgroup" + path + "/memory.max")) return lim;
+        } else {
+            std::stringstream ss(controllers);
+            std::string c;
+            while (std::getline(ss, c, ',')) {
+                if (c != "memory") continue;
+                if (auto lim = read_limit("/sys/fs/cgroup/memory" + path + "/memory.limit_in_bytes")) return lim;
+            }
+        }
+    }
+    // 容器内常只挂载了自身的 cgroup，路径不可见时读根
+    if (auto lim = read_limit("/sys/fs/cgroup/memory.max")) return lim;
+    return read_limit("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+}
+
+std::size_t BufferManager::auto_capacity(std::size_t page_size, double fraction) {
+    std::size_t budget;
+    if (auto lim = cgroup_memory_limit()) {
+        budget = *lim;
+    } else {
+        long pages = ::sysconf(_SC_PHYS_PAGES);
+        long ps = ::sysconf(_SC_PAGESIZE);
+        budget = pages > 0 && ps > 0 ? static_cast<std::size_t>(pages) * static_cast<std::size_t>(ps) : 0;
+    }
+    auto frames = static_cast<std::size_t>(static_cast<double>(budget) * std::clamp(fraction, 0.0, 1.0)) / page_size;
+    return std::clamp<std::size_t>(frames, 64, MAX_CAPACITY);
+}
+
+// ---------------- Warm-up ----------------
+
+std::vector<std::uint32_t> BufferManager::resident_pages() {
+    constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+    std::vector<std::uint32_t> pid_of(frame_limit_.load(), kNone);
+    for (auto& sh : shards_) {
+        std::lock_guard<std::mutex> lk(sh.mu);
+        for (const auto& [pid, idx] : sh.table) {
+            if (idx < pid_of.size()) pid_of[idx] = pid; // 期间扩容新增的帧本次不计
+        }
+    }
+    std::vector<std::size_t> order;
+    {
+        std::lock_guard<std::mutex> pl(pool_mu_);
+        const std::size_t limit = frame_limit_.load();
+        std::vector<bool> listed(limit, false);
+        auto add_reversed = [&](const std::list<std::size_t>& q) {
+            for (auto it = q.rbegin(); it != q.rend(); ++it) { order.push_back(*it); listed[*it] = true; }
+        };
+        if (policy_ == Policy::TWO_Q) {
+            add_reversed(am_);
+            add_reversed(a1in_);
+        } else if (policy_ == Policy::CLOCK) {
+            for (std::size_t i = 0; i < limit; ++i) {
+                if (!frame(i).in_ring) { order.push_back(i); listed[i] = true; }
+            }
+            std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+                return frame(a).usage.load(std::memory_order_relaxed) > frame(b).usage.load(std::memory_order_relaxed);
+            });
+        } else {
+            add_reversed(repl_list_);
+        }
+        // LRU/FIFO：被 pin 的帧不在队列中，它们正被使用，排在最前
+        std::vector<std::size_t> pinned;
+        for (std::size_t i = 0; i < limit; ++i) {
+            if (!listed[i] && !frame(i).in_ring) pinned.push_back(i);
+        }
+        order.insert(order.begin(), pinned.begin(), pinned.end());
+    }
+    std::vector<std::uint32_t> pages;
+    pages.reserve(order.size());
+    for (std::size_t idx : order) {
+        if (idx < pid_of.size() && pid_of[idx] != kNone) pages.push_back(pid_of[idx]);
+    }
+    return pages;
+}
+
+void BufferManager::save_warmup(const std::string& path) {
+    // 先写临时文件再改名，避免中途崩溃留下半个列表
+    auto pages = resident_pages();
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::trunc);
+        if (!ofs) throw std::runtime_error("Failed to write warm-up file " + tmp);
+        ofs << "pcsql-warmup " << page_size_ << "\n";
+        for (auto pid : pages) ofs << pid << "\n";
+        if (!ofs) throw std::runtime_error("Failed to write warm-up file " + tmp);
+    }
+    std::filesystem::rename(tmp, path);
+    log("saved ", pages.size(), " resident pages to ", path);
+}
+
+void BufferManager::start_warmup(const std::string& path) {
+    if (warmup_.joinable()) throw std::logic_error("warm-up already running");
+    std::ifstream ifs(path);
+    if (!ifs) return; // 没有预热文件（首次启动）
+    std::string magic;
+    std::size_t ps = 0;
+    if (!(ifs >> magic >> ps) || magic != "pcsql-warmup" || ps != page_size_) return; // 格式或页大小不符，忽略
+    std::size_t budget;
+    {
+        std::lock_guard<std::mutex> pl(pool_mu_);
+        budget = free_list_.size();
+    }
+    // 按近期性取前 budget 个仍然有效的页，再按页号排序以顺序读盘
+    std::vector<std::uint32_t> pages;
+    std::uint32_t pid;
+    while (pages.size() < budget && ifs >> pid) {
+        if (disk_.is_allocated(pid)) pages.push_back(pid);
+    }
+    std::sort(pages.begin(), pages.end());
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+    if (pages.empty()) return;
+    warmup_stop_ = false;
+    warmup_ = std::thread(&BufferManager::warmup_loop, this, std::move(pages));
+}
+
+void BufferManager::wait_warmup() {
+    if (warmup_.joinable()) warmup_.join();
+}
+
+void BufferManager::stop_warmup() {
+    warmup_stop_ = true;
+    wait_warmup();
+}
+
+void BufferManager::warmup_loop(std::vector<std::uint32_t> pages) {
+    constexpr std::size_t kBatch = 32;
+    AlignedBuffer stage(kBatch * page_size_);
+    try {
+        for (std::size_t first = 0; first < pages.size() && !warmup_stop_; first += kBatch) {
+            std::size_t last = std::min(first + kBatch, pages.size());
+            std::vector<IoRequest> reqs;
+            std::vector<std::uint32_t> epochs;
+            for (std::size_t n = first; n < last; ++n) {
+                epochs.push_back(write_epoch(pages[n]).load());
+                reqs.push_back(IoRequest{IoRequest::Op::Read, pages[n], stage.data() + (n - first) * page_size_, 0});
+            }
+            auto io = disk_.submit_async(std::move(reqs));
+            try { io->wait(); } catch (...) {} // 失败的请求单独跳过
+            for (std::size_t k = 0; k < io->requests().size() && !warmup_stop_; ++k) {
+                const IoRequest& r = io->requests()[k];
+                if (r.result != 0) continue;
+                if (!install_page(r.page_id, static_cast<const char*>(r.buffer), epochs[k])) return; // 没有空闲帧了
+            }
+        }
+    } catch (const std::exception& e) {
+        log("warm-up stopped: ", e.what());
+    }
+}
+
+bool BufferManager::install_page(std::uint32_t page_id, const char* data, std::uint32_t epoch) {
+    Shard& sh = shard_of(page_id);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    if (sh.table.count(page_id)) return true;               // 已被正常访问装入
+    if (write_epoch(page_id).load() != epoch) return true;  // 读盘后该页被写回过，副本可能过时
+    std::size_t idx;
+    {
+        std::lock_guard<std::mutex> pl(pool_mu_);
+        if (free_list_.empty()) return false;
+        idx = free_list_.back();
+        free_list_.pop_back();
+    }
+    Frame& f = frame(idx);
     f.page.page_id = page_id;
-    disk_.read_page(page_id, f.page.data.data());
+    std::memcpy(f.page.data.data(), data, page_size_);
+    auto tag = sh.tags.find(page_id);
+    f.page.kind.store(tag != sh.tags.end() ? tag->second.kind : PageKind::Unknown, std::memory_order_relaxed);
+    f.page.owner.store(tag != sh.tags.end() ? tag->second.owner : -1, std::memory_order_relaxed);
     f.dirty = false;
-    f.pin_count = 1; // pinned by caller
-    used_[idx] = true;//填充used_
-    page_table_[page_id] = idx;//填充page_table_
-    log("MISS load page " + std::to_string(page_id) + " into frame " + std::to_string(idx));
-    return f.page;
+    f.usage = 1;
+    f.pin_count = 0;
+    f.resident = true;
+    {
+        std::lock_guard<std::mutex> pl(pool_mu_);
+        if (policy_ == Policy::TWO_Q) {
+            // 预热的页上次运行时是常驻页，直接进入 Am
+            am_.push_back(idx);
+            q_where_[idx] = TwoQQueue::Am;
+            q_pos_[idx] = std::prev(am_.end());
+        } else if (policy_ != Policy::CLOCK) {
+            on_unpinned(idx);
+        }
+    }
+    sh.table[page_id] = idx;
+    stats_.prewarmed++;
+    return true;
+}
+
+// ---------------- ScanContext ----------------
+
+ScanContext::ScanContext(BufferManager& buffer, std::vector<std::uint32_t> pages,
+                         std::size_t ring_size, std::size_t readahead)
+    : buffer_(buffer), pages_(std::move(pages)),
+      ring_size_(std::clamp<std::size_t>(ring_size, 1, std::max<std::size_t>(1, buffer.capacity() / 4))),
+      readahead_(std::min(readahead, pages_.size())) {
+    if (readahead_ > 0) stage_.reset(2 * readahead_ * buffer.page_size());
+}
+
+ScanContext::~ScanContext() {
+    buffer_.end_scan(*this);
+}
+
+void BufferManager::scan_advance(ScanContext& scan, std::uint32_t page_id) {
+    // 只跟踪按计划顺序的访问；乱序访问照常读取，不触发预读
+    if (scan.pos_ >= scan.pages_.size() || scan.pages_[scan.pos_] != page_id) return;
+    std::size_t batch = scan.readahead_ ? scan.pos_ / scan.readahead_ : 0;
+    ++scan.pos_;
+    if (scan.readahead_ == 0) return;
+    // 保持当前批与下一批都已发出：消费第 b 批时第 b+1 批在后台读取
+    while (scan.issued_ <= batch + 1 && scan.issued_ * scan.readahead_ < scan.pages_.size()) {
+        issue_readahead(scan, scan.issued_++);
+    }
+}
+
+void BufferManager::issue_readahead(ScanContext& scan, std::size_t batch) {
+    auto& half = scan.halves_[batch % 2];
+    // 这一半上次装的是第 batch-2 批，早已消费完；等它落地后才能复用缓冲区
+    if (half.io) {
+        try { half.io->wait(); } catch (...) {}
+        for (const auto& r : half.io->requests()) {
+            auto it = scan.staged_.find(r.page_id);
+            if (it != scan.staged_.end() && it->second.half == batch % 2) scan.staged_.erase(it);
+        }
+        half.io.reset();
+    }
+    half.epochs.clear();
+
+    char* base = scan.stage_.data() + (batch % 2) * scan.readahead_ * page_size_;
+    std::size_t first = batch * scan.readahead_;
+    std::size_t last = std::min(first + scan.readahead_, scan.pages_.size());
+    std::vector<IoRequest> reqs;
+    for (std::size_t n = first; n < last; ++n) {
+        std::uint32_t pid = scan.pages_[n];
+        {
+            Shard& sh = shard_of(pid);
+            std::lock_guard<std::mutex> lk(sh.mu);
+            if (sh.table.count(pid)) continue; // 已在缓冲池中，无需预读
+        }
+        if (scan.staged_.count(pid)) continue;
+        half.epochs.push_back(write_epoch(pid).load());
+        scan.staged_[pid] = ScanContext::StagedPage{batch % 2, reqs.size()};
+        reqs.push_back(IoRequest{IoRequest::Op::Read, pid, base + (n - first) * page_size_, 0});
+    }
+    if (reqs.empty()) return;
+    try {
+        half.io = disk_.submit_async(std::move(reqs));
+    } catch (const std::exception& e) {
+        // 预读只是优化：失败时这些页走同步读取
+        for (std::size_t n = first; n < last; ++n) {
+            auto it = scan.staged_.find(scan.pages_[n]);
+            if (it != scan.staged_.end() && it->second.half == batch % 2) scan.staged_.erase(it);
+        }
+        log("readahead failed: ", e.what());
+    }
+}
+
+bool BufferManager::take_staged(ScanContext& scan, std::uint32_t page_id, char* dst) {
+    // 调用方持有 page_id 所在分片锁，且该页不在缓冲池中
+    auto it = scan.staged_.find(page_id);
+    if (it == scan.staged_.end()) return false;
+    ScanContext::StagedPage sp = it->second;
+    scan.staged_.erase(it);
+    auto& half = scan.halves_[sp.half];
+    try { half.io->wait(); } catch (...) {}
+    const IoRequest& r = half.io->requests()[sp.req];
+    // 读发出之后该页若被写回过（或写回与读重叠），副本可能过时，改为同步读取
+    if (r.result != 0 || write_epoch(page_id).load() != half.epochs[sp.req]) return false;
+    std::memcpy(dst, r.buffer, page_size_);
+    return true;
+}
+
+void BufferManager::end_scan(ScanContext& scan) {
+    for (auto& half : scan.halves_) {
+        if (!half.io) continue;
+        try { half.io->wait(); } catch (...) {} // 缓冲区随上下文释放，必须等在途读取完成
+        half.io.reset();
+    }
+    scan.staged_.clear();
+    std::lock_guard<std::mutex> pl(pool_mu_);
+    // 环中的页是刚扫过的，作为共享池的下一批受害者
+    for (std::size_t idx : scan.ring_) demote_ring_frame(idx, false);
+    scan.ring_.clear();
 }
 
 void BufferManager::unpin_page(std::uint32_t page_id, bool dirty) {
-    auto it = page_table_.find(page_id);
-    if (it == page_table_.end()) throw std::out_of_range("page not in buffer");
-    Frame& f = frames_[it->second];
-    if (f.pin_count == 0) throw std::logic_error("unpin on already unpinned page");
-    f.pin_count--;
-    f.dirty = f.dirty || dirty;
-    if (f.pin_count == 0) {
+    Shard& sh = shard_of(page_id);
+    std::lock_guard<std::mutex> lk(sh.mu);
+    auto it = sh.table.find(page_id);
+    if (it == sh.table.end()) throw std::out_of_range("page not in buffer");
+    Frame& f = frame(it->second);
+    if (f.pin_count.load() == 0) throw std::logic_error("unpin on already unpinned page");
+    if (dirty) f.dirty = true;
+    if (--f.pin_count == 0 && policy_ != Policy::CLOCK && policy_ != Policy::TWO_Q) {
+        std::lock_guard<std::mutex> pl(pool_mu_);
         on_unpinned(it->second);
     }
 }
 
 void BufferManager::on_unpinned(std::size_t frame_idx) {
+    if (frame(frame_idx).in_ring) return; // 扫描环里的帧由扫描自己回收
     // 加入替换队列队尾；如已存在则先移除再加入（实现LRU“最近使用”的效果）。
     auto itpos = repl_pos_.find(frame_idx);
     if (itpos != repl_pos_.end()) {
@@ -102,38 +993,230 @@ void BufferManager::on_unpinned(std::size_t frame_idx) {
     repl_pos_[frame_idx] = std::prev(repl_list_.end());
 }
 
-std::size_t BufferManager::pick_victim() {
-    // Victim from front of list; ensure available
-    if (repl_list_.empty()) throw std::runtime_error("No frame available for eviction (all pinned)");
-    std::size_t idx = repl_list_.front();
-    repl_list_.pop_front();
-    repl_pos_.erase(idx);
-    return idx;
-}
-
 void BufferManager::flush_page(std::uint32_t page_id) {
-    //写回单页
-    auto it = page_table_.find(page_id);
-    if (it == page_table_.end()) return; // not in buffer
-    Frame& f = frames_[it->second];
-    if (f.dirty) {
+    //写回单页：不 pin、不在持有分片锁时等待页闩。持有共享页闩期间该帧不会被驱逐（驱逐需 try_lock 独占页闩），
+    //拿到页闩后再确认页仍映射在同一帧；此时分片锁只能 try_lock（discard_page 持分片锁等页闩），拿不到就放开页闩重来
+    Shard& sh = shard_of(page_id);
+    std::size_t idx;
+    std::shared_lock<std::shared_mutex> latch;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lk(sh.mu);
+            auto it = sh.table.find(page_id);
+            if (it == sh.table.end()) return; // not in buffer
+            idx = it->second;
+            if (!frame(idx).dirty) return;
+        }
+        latch = std::shared_lock<std::shared_mutex>(frame(idx).page.latch);
+        std::unique_lock<std::mutex> lk(sh.mu, std::try_to_lock);
+        if (lk.owns_lock()) {
+            auto it = sh.table.find(page_id);
+            if (it == sh.table.end() || it->second != idx) return; // 期间已被驱逐（驱逐时已写回）
+            break;
+        }
+        latch.unlock();
+        std::this_thread::yield();
+    }
+    Frame& f = frame(idx);
+    if (!f.dirty.exchange(false)) return;
+    write_epoch(page_id)++;
+    try {
         disk_.write_page(page_id, f.page.data.data());
-        f.dirty = false;
-        stats_.flushes++;
-        log("FLUSH page " + std::to_string(page_id));
+    } catch (...) {
+        write_epoch(page_id)++;
+        f.dirty = true;
+        throw;
     }
+    write_epoch(page_id)++;
+    stats_.flushes++;
+    log("FLUSH page ", page_id);
 }
 
 void BufferManager::flush_all() {
-    for (std::size_t i = 0; i < frames_.size(); ++i) {
-        Frame& f = frames_[i];
-        if (used_[i] && f.dirty) {
-            disk_.write_page(f.page.page_id, f.page.data.data());
-            f.dirty = false;
-            stats_.flushes++;
-            log("FLUSH page " + std::to_string(f.page.page_id));
+    // 1) 逐分片收集脏页
+    std::vector<std::pair<std::uint32_t, std::size_t>> dirty;
+    for (auto& sh : shards_) {
+        std::lock_guard<std::mutex> lk(sh.mu);
+        for (const auto& [pid, idx] : sh.table) {
+            if (frame(idx).dirty) dirty.emplace_back(pid, idx);
+        }
+    }
+    if (dirty.empty()) return;
+
+    // 2) 能立即拿到共享页闩的页一次性提交给异步 I/O 引擎，让多个写请求同时在途；
+    //    拿不到的（有写者，或其分片锁正忙）稍后逐页走 flush_page，任何时刻最多等待一个页闩，避免与持有多个页闩的写者成环
+    std::vector<std::uint32_t> deferred;
+    write_back(dirty, &deferred);
+    for (std::uint32_t pid : deferred) flush_page(pid);
+}
+
+std::size_t BufferManager::write_back(const std::vector<std::pair<std::uint32_t, std::size_t>>& pages,
+                                      std::vector<std::uint32_t>* deferred) {
+    std::vector<std::pair<std::uint32_t, std::size_t>> batched;
+    std::vector<IoRequest> reqs;
+    for (const auto& [pid, idx] : pages) {
+        Frame& f = frame(idx);
+        if (!f.page.latch.try_lock_shared()) {
+            if (deferred) deferred->push_back(pid);
+            continue;
+        }
+        // 已持有页闩（本帧及此前批入的帧）时只能 try_lock 分片锁：discard_page 持分片锁等这些页闩，阻塞等待会成环
+        bool same;
+        {
+            Shard& sh = shard_of(pid);
+            std::unique_lock<std::mutex> lk(sh.mu, std::try_to_lock);
+            if (!lk.owns_lock()) {
+                f.page.latch.unlock_shared();
+                if (deferred) deferred->push_back(pid);
+                continue;
+            }
+            auto it = sh.table.find(pid);
+            same = it != sh.table.end() && it->second == idx;
+        }
+        if (same && f.dirty.exchange(false)) {
+            write_epoch(pid)++;
+            reqs.push_back(IoRequest{IoRequest::Op::Write, pid, f.page.data.data(), 0});
+            batched.emplace_back(pid, idx);
+        } else {
+            f.page.latch.unlock_shared();
+        }
+    }
+    try {
+        if (reqs.size() == 1) {
+            disk_.write_page(reqs[0].page_id, reqs[0].buffer);
+        } else if (!reqs.empty()) {
+            disk_.submit_async(std::move(reqs))->wait();
+        }
+    } catch (...) {
+        for (const auto& [pid, idx] : batched) {
+            write_epoch(pid)++;
+            frame(idx).dirty = true;
+            frame(idx).page.latch.unlock_shared();
+        }
+        throw;
+    }
+    for (const auto& [pid, idx] : batched) {
+        write_epoch(pid)++;
+        frame(idx).page.latch.unlock_shared();
+        stats_.flushes++;
+        log("FLUSH page ", pid);
+    }
+    return batched.size();
+}
+
+std::size_t BufferManager::dirty_pages() const {
+    std::size_t n = 0;
+    const std::size_t limit = frame_limit_.load();
+    for (std::size_t i = 0; i < limit; ++i) {
+        if (frame(i).resident.load() && frame(i).dirty.load()) ++n;
+    }
+    return n;
+}
+
+std::vector<std::size_t> BufferManager::eviction_order() const {
+    std::vector<std::size_t> order;
+    const std::size_t limit = frame_limit_.load();
+    order.reserve(limit);
+    if (policy_ == Policy::CLOCK) {
+        // 从指针处绕一圈；使用计数为 0 的帧最先被淘汰，其余按指针顺序
+        for (int pass = 0; pass < 2; ++pass) {
+            for (std::size_t k = 0; k < limit; ++k) {
+                std::size_t i = (clock_hand_ + k) % limit;
+                bool cold = frame(i).usage.load(std::memory_order_relaxed) == 0;
+                if (frame(i).resident.load() && !frame(i).in_ring && cold == (pass == 0)) order.push_back(i);
+            }
+        }
+    } else if (policy_ == Policy::TWO_Q) {
+        // 与 pick_two_q 的选择顺序一致
+        bool a1in_first = a1in_.size() > a1in_target_;
+        const auto& q1 = a1in_first ? a1in_ : am_;
+        const auto& q2 = a1in_first ? am_ : a1in_;
+        order.insert(order.end(), q1.begin(), q1.end());
+        order.insert(order.end(), q2.begin(), q2.end());
+    } else {
+        order.assign(repl_list_.begin(), repl_list_.end());
+    }
+    return order;
+}
+
+std::size_t BufferManager::background_write_round(const WriterOptions& opts) {
+    // 1) 分片锁下取得 帧 -> 页号 映射（页号只在持有分片锁时可靠）
+    constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+    std::vector<std::uint32_t> pid_of(frame_limit_.load(), kNone);
+    std::size_t dirty = 0;
+    for (auto& sh : shards_) {
+        std::lock_guard<std::mutex> lk(sh.mu);
+        for (const auto& [pid, idx] : sh.table) {
+            if (idx >= pid_of.size()) continue; // 期间扩容新增的帧留给下一轮
+            pid_of[idx] = pid;
+            if (frame(idx).dirty) ++dirty;
+        }
+    }
+    if (dirty == 0) return 0;
+
+    std::vector<std::size_t> order;
+    {
+        std::lock_guard<std::mutex> pl(pool_mu_);
+        order = eviction_order();
+    }
+
+    // 2) 按淘汰顺序挑选脏且未 pin 的帧：前 lookahead 个候选全部写回；超过脏页比例目标时继续向后写
+    const std::size_t cap = capacity();
+    std::size_t lookahead = opts.lookahead ? opts.lookahead : std::max<std::size_t>(1, cap / 8);
+    double ratio = std::clamp(opts.dirty_ratio_target, 0.0, 1.0);
+    std::size_t allowed = static_cast<std::size_t>(ratio * static_cast<double>(cap));
+    std::vector<std::pair<std::uint32_t, std::size_t>> picked;
+    for (std::size_t n = 0; n < order.size() && picked.size() < opts.max_pages_per_round; ++n) {
+        if (n >= lookahead && dirty <= allowed) break;
+        std::size_t idx = order[n];
+        const Frame& f = frame(idx);
+        if (idx >= pid_of.size() || pid_of[idx] == kNone || !f.dirty.load() || f.pin_count.load() != 0) continue;
+        picked.emplace_back(pid_of[idx], idx);
+        --dirty;
+    }
+    if (picked.empty()) return 0;
+
+    // 3) 批量写回；页闩忙的页（有写者）本轮跳过
+    std::size_t written = write_back(picked, nullptr);
+    stats_.background_flushes += written;
+    return written;
+}
+
+void BufferManager::start_background_writer(const WriterOptions& opts) {
+    if (writer_.joinable()) throw std::logic_error("background writer already running");
+    if (opts.max_pages_per_round == 0) throw std::invalid_argument("max_pages_per_round must be > 0");
+    {
+        std::lock_guard<std::mutex> lk(writer_mu_);
+        writer_stop_ = false;
+    }
+    writer_ = std::thread(&BufferManager::writer_loop, this, opts);
+}
+
+void BufferManager::stop_background_writer() {
+    if (!writer_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lk(writer_mu_);
+        writer_stop_ = true;
+    }
+    writer_cv_.notify_one();
+    writer_.join();
+}
+
+void BufferManager::writer_loop(WriterOptions opts) {
+    std::unique_lock<std::mutex> lk(writer_mu_);
+    while (!writer_stop_) {
+        writer_cv_.wait_for(lk, opts.interval, [&] { return writer_stop_ || writer_kick_.load(); });
+        if (writer_stop_) break;
+        writer_kick_ = false;
+        lk.unlock();
+        try {
+            background_write_round(opts);
+        } catch (const std::exception& e) {
+            // 写失败的页仍是脏页，留给下一轮或驱逐路径重试
+            log("background writer: ", e.what());
         }
+        lk.lock();
     }
 }
 
-} // namespace pcsql
\ No newline at end of file
+} // namespace pcsql
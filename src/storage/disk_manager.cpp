@@ -1,192 +1,426 @@
 #include "storage/disk_manager.hpp"                              //引入头文件 disk_manager.hpp，里面声明了 DiskManager 类
 
+#include <cerrno>
 #include <cstdio>
+#include <algorithm>
 #include <cstring>
-#include <fstream>
-#include <iostream>
-#include <sstream>
 #include <stdexcept>
+#include <fcntl.h>
 #include <sys/stat.h>
-#include <array>
+#include <unistd.h>
+#include <vector>
 
 namespace pcsql {                                                //定义命名空间 pcsql，避免名字冲突
 
-static bool file_exists(const std::filesystem::path& p) {        //检查p路径文件是否存在，存在返回0
-    struct stat st{};
-    // return ::stat(p.c_str(), &st) == 0;
-    return ::stat(p.string().c_str(), &st) == 0;
+static std::runtime_error io_error(const char* what) {
+    return std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+}
+
+// pread/pwrite 可能被信号打断或只完成部分字节，循环直到读/写满
+static std::size_t pread_full(int fd, void* buf, std::size_t n, std::uint64_t off) {
+    char* p = static_cast<char*>(buf);
+    std::size_t done = 0;
+    while (done < n) {
+        ssize_t k = ::pread(fd, p + done, n - done, static_cast<off_t>(off + done));
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            throw io_error("pread failed");
+        }
+        if (k == 0) break; // EOF
+        done += static_cast<std::size_t>(k);
+    }
+    return done;
+}
+
+static void pwrite_full(int fd, const void* buf, std::size_t n, std::uint64_t off) {
+    const char* p = static_cast<const char*>(buf);
+    std::size_t done = 0;
+    while (done < n) {
+        ssize_t k = ::pwrite(fd, p + done, n - done, static_cast<off_t>(off + done));
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            throw io_error("pwrite failed");
+        }
+        done += static_cast<std::size_t>(k);
+    }
+}
+
+static constexpr char SUPER_MAGIC[8] = {'P', 'C', 'S', 'Q', 'L', 'D', 'B', '\0'};
+static constexpr std::uint32_t SUPER_VERSION = 1;
+
+void DiskManager::check_superblock(const SuperBlock& sb, const std::filesystem::path& where) {
+    if (std::memcmp(sb.magic, SUPER_MAGIC, sizeof(SUPER_MAGIC)) != 0) {
+        throw std::runtime_error("data.db has no superblock (legacy text meta layout?); recreate " + where.string());
+    }
+    if (sb.version != SUPER_VERSION) throw std::runtime_error("Unsupported data.db version");
+    if (!valid_page_size(sb.page_size)) throw std::runtime_error("Invalid page size in superblock");
+}
+
+std::size_t DiskManager::probe_page_size(const std::filesystem::path& db_path) {
+    int fd = ::open(db_path.string().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw io_error("Failed to open db file");
+    SuperBlock sb{};
+    std::size_t n = 0;
+    try {
+        n = pread_full(fd, &sb, sizeof(sb), 0);
+    } catch (...) {
+        ::close(fd);
+        throw;
     }
+    ::close(fd);
+    if (n != sizeof(sb)) throw std::runtime_error("data.db too small for superblock");
+    check_superblock(sb, db_path.parent_path());
+    return sb.page_size;
+}
 
 /*
 base_dir_: 存储目录，转为绝对路径。
 db_path_: 数据文件路径。
-meta_path_: 元数据文件路径。
-init_files(): 若文件不存在则创建。
-load_meta(): 读取元数据（下一页 ID 和空闲页列表）。*/
+init_files(): 打开数据文件（不存在则创建；可选 O_DIRECT）。
+load_space_map(): 读取超级块与空闲页位图（新文件则按请求的页大小格式化，已有文件以超级块中的页大小为准）。*/
 DiskManager::DiskManager(const std::string& base_dir,
                          const std::string& db_file,
-                         const std::string& meta_file)
+                         const DiskOptions& options)
     : base_dir_(std::filesystem::absolute(base_dir)),
       db_path_(base_dir_ / db_file),
-      meta_path_(base_dir_ / meta_file) {
-    init_files();
-    load_meta();
+      extent_request_(options.extent_bytes),
+      io_backend_(options.io_backend),
+      io_threads_(options.io_threads) {
+    init_files(options.direct_io);
+    load_space_map(options.page_size);
+}
+
+void DiskManager::set_page_size(std::size_t page_size) {
+    // 页大小决定位图分组粒度与 extent 的页数
+    page_size_ = page_size;
+    bits_per_map_ = static_cast<std::uint32_t>(page_size * 8);
+    words_per_map_ = page_size / sizeof(std::uint64_t);
+    std::size_t extent = std::min(std::max(extent_request_, page_size_), MAX_EXTENT_BYTES);
+    extent_pages_ = static_cast<std::uint32_t>(extent / page_size_);
 }
 
-void DiskManager::init_files() {
+DiskManager::~DiskManager() {
+    try {
+        reserved_end_ = next_page_id_; // 正常关闭：写出精确的位图，预留未用的页不再标记为已用
+        sync();
+    } catch (...) {
+        // ignore exceptions during shutdown
+    }
+    aio_.reset(); // 先停掉异步引擎（等在途请求完成），再关闭描述符
+    if (fd_ >= 0) ::close(fd_);
+}
+
+void DiskManager::init_files(bool want_direct) {
     std::filesystem::create_directories(base_dir_);//确保数据库目录存在（没有则创建）。
-    if (!file_exists(db_path_)) {
-        std::ofstream ofs(db_path_, std::ios::binary);
-        if (!ofs) throw std::runtime_error("Failed to create db file");
-    }//如果数据库文件不存在，就新建一个空文件
-    if (!file_exists(meta_path_)) {
-        // Text meta format:
-        // line 1: next_page_id\n
-        // line 2: space-separated free list (may be empty)\n
-        std::ofstream ofs(meta_path_);
-        if (!ofs) throw std::runtime_error("Failed to create meta file");
-        ofs << 0 << "\n";
-        ofs << "\n"; // empty free list
-    }// 如果元数据文件不存在，就新建：
-     // 第一行写 0（下一页 ID 初始为 0）。
-     // 第二行空行（空闲页列表为空）。
-}
-
-void DiskManager::load_meta() {
-    std::ifstream ifs(meta_path_);
-    if (!ifs) throw std::runtime_error("Failed to open meta file");//打开元数据文件，失败抛异常。
-    std::string line;
-    // line 1: next_page_id
-    if (!std::getline(ifs, line)) throw std::runtime_error("Invalid meta file: missing next_page_id");//读取第一行（下一页 ID）
-    {
-        std::istringstream iss(line);
-        iss >> next_page_id_;
-        if (!iss) next_page_id_ = 0;
-    }//从字符串中解析 next_page_id_，若失败则设为 0
-    // line 2: free list
+    // 打开（不存在则创建）数据文件，描述符一直保持到析构
+    const int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+    if (want_direct) {
+        // O_DIRECT 绕过内核页缓存，页只在缓冲池中缓存一份；文件系统不支持时退回普通 I/O
+        fd_ = ::open(db_path_.string().c_str(), flags | O_DIRECT, 0644);
+        direct_io_ = fd_ >= 0;
+        if (fd_ < 0 && errno != EINVAL) throw io_error("Failed to open db file");
+    }
+    if (fd_ < 0) fd_ = ::open(db_path_.string().c_str(), flags, 0644);
+    if (fd_ < 0) throw io_error("Failed to open db file");
+    struct stat st{};
+    if (::fstat(fd_, &st) != 0) throw io_error("Failed to stat db file");
+    file_size_ = static_cast<std::uint64_t>(st.st_size);
+}
+
+void DiskManager::format_new() {
+    // 新库：页 0 为超级块，页 1 为第 0 组位图，二者自身都标记为已用
+    next_page_id_ = 0;
+    bitmaps_.clear();
+    bitmap_dirty_.clear();
+    add_bitmap_group();
+    set_bit(SUPERBLOCK_PAGE, true);
+    next_page_id_ = 2;
+    reserved_end_ = next_page_id_;
+    super_dirty_ = true;
+    sync();
+}
+
+void DiskManager::load_space_map(std::size_t requested_page_size) {
+    if (file_size_ == 0) {
+        if (!valid_page_size(requested_page_size)) {
+            throw std::invalid_argument("page size must be a power of two in [4KB, 64KB]");
+        }
+        set_page_size(requested_page_size);
+        format_new();
+        return;
+    }
+    // 页大小尚未知：先读最小页大小的一块（O_DIRECT 要求对齐的缓冲区与长度）
+    if (file_size_ < MIN_PAGE_SIZE) throw std::runtime_error("data.db too small for superblock");
+    AlignedBuffer head(MIN_PAGE_SIZE);
+    if (pread_full(fd_, head.data(), MIN_PAGE_SIZE, 0) != MIN_PAGE_SIZE) throw std::runtime_error("Short read");
+    SuperBlock sb{};
+    std::memcpy(&sb, head.data(), sizeof(sb));
+    check_superblock(sb, base_dir_);
+    set_page_size(sb.page_size);
+    if (sb.bitmap_count == 0) throw std::runtime_error("Invalid superblock: no bitmap pages");
+    next_page_id_ = sb.next_page_id;
+
+    bitmaps_.assign(sb.bitmap_count, std::vector<std::uint64_t>(words_per_map_, 0));
+    bitmap_dirty_.assign(sb.bitmap_count, false);
+    for (std::uint32_t g = 0; g < sb.bitmap_count; ++g) {
+        read_page(bitmap_page_of(g), bitmaps_[g].data());
+    }
+    // 位图随分配写穿，超级块只在新增分组时写：崩溃后 next_page_id 可能落后，以最高的已用页为准
+    for (std::uint32_t g = sb.bitmap_count; g-- > 0;) {
+        const auto& words = bitmaps_[g];
+        auto w = std::find_if(words.rbegin(), words.rend(), [](std::uint64_t x) { return x != 0; });
+        if (w == words.rend()) continue;
+        std::uint64_t word = static_cast<std::uint64_t>(words.rend() - w - 1);
+        std::uint64_t top = static_cast<std::uint64_t>(g) * bits_per_map_ + word * 64 + (63 - static_cast<std::uint64_t>(__builtin_clzll(*w)));
+        next_page_id_ = std::max<std::uint32_t>(next_page_id_, static_cast<std::uint32_t>(top + 1));
+        break;
+    }
+    reserved_end_ = next_page_id_;
+
+    // 由位图重建空闲页栈：倒序压栈，使 allocate 优先复用低页号
     free_list_.clear();
-    if (std::getline(ifs, line)) {
-        std::istringstream iss(line);
-        std::uint32_t v;
-        while (iss >> v) free_list_.push_back(v);
-    }//读取第二行（空闲页 ID 列表），解析并存入 free_list_
+    for (std::uint32_t g = sb.bitmap_count; g-- > 0;) {
+        const auto& words = bitmaps_[g];
+        for (std::size_t w = words_per_map_; w-- > 0;) {
+            if (words[w] == ~std::uint64_t{0}) continue;
+            for (int b = 63; b >= 0; --b) {
+                if (words[w] & (std::uint64_t{1} << b)) continue;
+                std::uint64_t pid = static_cast<std::uint64_t>(g) * bits_per_map_ + w * 64 + static_cast<std::uint64_t>(b);
+                if (pid < next_page_id_) free_list_.push_back(static_cast<std::uint32_t>(pid));
+            }
+        }
+    }
+}
+
+void DiskManager::sync() {
+    std::lock_guard<std::mutex> lk(space_mu_);
+    write_bitmaps();
+    if (super_dirty_) write_superblock();
 }
 
-void DiskManager::save_meta() const {
-    std::ofstream ofs(meta_path_);
-    if (!ofs) throw std::runtime_error("Failed to write meta file");
-    ofs << next_page_id_ << "\n";
-    for (std::size_t i = 0; i < free_list_.size(); ++i) {
-        ofs << free_list_[i];
-        if (i + 1 < free_list_.size()) ofs << ' ';
+void DiskManager::write_bitmaps() {
+    std::vector<std::uint64_t> image;
+    for (std::size_t g = 0; g < bitmaps_.size(); ++g) {
+        if (!bitmap_dirty_[g]) continue;
+        const std::uint64_t* words = bitmaps_[g].data();
+        // 盘上的位图把预留区间 [next_page_id_, reserved_end_) 也标为已用：区间内的新页分配时不再写位图
+        std::uint64_t lo = static_cast<std::uint64_t>(g) * bits_per_map_;
+        std::uint64_t from = std::max<std::uint64_t>(next_page_id_, lo);
+        std::uint64_t to = std::min<std::uint64_t>(reserved_end_, lo + bits_per_map_);
+        if (from < to) {
+            image = bitmaps_[g];
+            for (std::uint64_t pid = from; pid < to; ++pid) {
+                std::uint64_t bit = pid - lo;
+                image[bit / 64] |= std::uint64_t{1} << (bit % 64);
+            }
+            words = image.data();
+        }
+        write_page(bitmap_page_of(static_cast<std::uint32_t>(g)), words);
+        bitmap_dirty_[g] = false;
     }
-    ofs << "\n";
+}
 
-    /*
-    保存元数据
-    1.以输出模式打开元数据文件
-    2.写入下一页 ID
-    3.写入空闲页列表
-    */
+void DiskManager::write_superblock() {
+    AlignedBuffer buf(page_size_);
+    SuperBlock sb{};
+    std::memcpy(sb.magic, SUPER_MAGIC, sizeof(SUPER_MAGIC));
+    sb.version = SUPER_VERSION;
+    sb.page_size = static_cast<std::uint32_t>(page_size_);
+    sb.next_page_id = next_page_id_;
+    sb.bitmap_count = static_cast<std::uint32_t>(bitmaps_.size());
+    std::memcpy(buf.data(), &sb, sizeof(sb));
+    write_page(SUPERBLOCK_PAGE, buf.data());
+    super_dirty_ = false;
+}
+
+void DiskManager::add_bitmap_group() {
+    // 新分组的位图页就是该组的第一页（第 0 组例外，位于页 1）
+    auto group = static_cast<std::uint32_t>(bitmaps_.size());
+    bitmaps_.emplace_back(words_per_map_, 0);
+    bitmap_dirty_.push_back(true);
+    set_bit(bitmap_page_of(group), true);
+    ensure_file_size_for(bitmap_page_of(group));
+    super_dirty_ = true;
+}
+
+bool DiskManager::test_bit(std::uint32_t page_id) const {
+    std::uint32_t g = page_id / bits_per_map_;
+    if (g >= bitmaps_.size()) return false;
+    std::uint32_t bit = page_id % bits_per_map_;
+    return (bitmaps_[g][bit / 64] >> (bit % 64)) & 1u;
+}
+
+void DiskManager::set_bit(std::uint32_t page_id, bool used) {
+    std::uint32_t g = page_id / bits_per_map_;
+    std::uint32_t bit = page_id % bits_per_map_;
+    std::uint64_t mask = std::uint64_t{1} << (bit % 64);
+    if (used) bitmaps_[g][bit / 64] |= mask;
+    else bitmaps_[g][bit / 64] &= ~mask;
+    bitmap_dirty_[g] = true;
 }
 
 void DiskManager::ensure_file_size_for(std::uint32_t page_id) {
-    std::ifstream ifs(db_path_, std::ios::binary | std::ios::ate);
-    std::uint64_t size = 0;
-    if (ifs) size = static_cast<std::uint64_t>(ifs.tellg());//打开数据库文件，获取当前大小
-    std::uint64_t required = (static_cast<std::uint64_t>(page_id) + 1) * PAGE_SIZE;//计算需要的最小文件大小（能容纳到 page_id 这一页）。
-    if (size < required) {
-        std::ofstream ofs(db_path_, std::ios::binary | std::ios::app);
-        if (!ofs) throw std::runtime_error("Failed to expand db file");
-        std::uint64_t to_write = required - size;//需要扩展to_write大小 如果文件不够大，追加写入零字节补齐。
-        // write zeros
-        const std::size_t chunk_size = 4096;
-        char zeros[chunk_size];
-        std::memset(zeros, 0, chunk_size);
-        while (to_write > 0) {
-            std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(to_write, chunk_size));//取to_write 和 4096的最小值
-            ofs.write(zeros, static_cast<std::streamsize>(chunk));
-            to_write -= chunk;//写完减去
-        }//分块写入 0（初始化新扩展部分），避免一次写太大内存。
+    //计算需要的最小文件大小（能容纳到 page_id 这一页）；缓存的 file_size_ 足够时无需任何系统调用
+    std::uint64_t required = (static_cast<std::uint64_t>(page_id) + 1) * page_size_;
+    if (file_size_ >= required) return;
+    // 按 extent 整块扩展：向上取整到 extent 边界，一次预留多页
+    std::uint64_t extent = static_cast<std::uint64_t>(extent_pages_) * page_size_;
+    std::uint64_t target = (required + extent - 1) / extent * extent;
+    // fallocate 预分配磁盘块（新区域读出为 0）；文件系统不支持时退化为 ftruncate（稀疏扩展，同样读出为 0）
+    int rc = ::fallocate(fd_, 0, static_cast<off_t>(file_size_), static_cast<off_t>(target - file_size_));
+    if (rc != 0 && (errno == EOPNOTSUPP || errno == ENOSYS)) {
+        rc = ::ftruncate(fd_, static_cast<off_t>(target));
+    }
+    if (rc != 0) throw io_error("Failed to expand db file");
+    file_size_ = target;
+}
+
+void DiskManager::zero_page(std::uint32_t page_id) {
+    // 复用的空闲页可能残留旧数据：优先打洞（无需写数据，之后读出为 0），不支持时才同步写 0
+    std::uint64_t offset = static_cast<std::uint64_t>(page_id) * page_size_;
+    if (::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                    static_cast<off_t>(offset), static_cast<off_t>(page_size_)) == 0) {
+        return;
     }
+    AlignedBuffer zeros(page_size_); // zero-filled
+    write_page(page_id, zeros.data());
 }
 
 
 std::uint32_t DiskManager::allocate_page() {
+    std::lock_guard<std::mutex> lk(space_mu_);
     std::uint32_t page_id;
-    if (!free_list_.empty()) {
+    bool new_group = false;
+    const bool recycled = !free_list_.empty();
+    if (recycled) {
         page_id = free_list_.back();
         free_list_.pop_back();
+        zero_page(page_id);
     } else {
+        if (next_page_id_ % bits_per_map_ == 0 && next_page_id_ / bits_per_map_ >= bitmaps_.size()) {
+            // 跨入新分组：该组首页用作位图页
+            add_bitmap_group();
+            ++next_page_id_;
+            new_group = true;
+        }
         page_id = next_page_id_++;
+        super_dirty_ = true;
+        // 预留 extent 内的新页本身就是 0，不再同步写零页
         ensure_file_size_for(page_id);
     }
-    // 始终将页内容清零，避免复用空闲页时残留数据
-    std::array<char, PAGE_SIZE> zeros{}; // value-initialized to 0
-    write_page(page_id, zeros.data(), PAGE_SIZE);
-    save_meta();
-    std::cout << "allocate_page: " << page_id << std::endl;
+    set_bit(page_id, true);
+    if (!recycled) {
+        if (page_id < reserved_end_) return page_id; // 盘上已标记为已用（预留区间），位图留到下次写出
+        // 新页越过了上次的预留：把本 extent 余下的页（不跨分组）一并在盘上标记，只写这一次
+        std::uint64_t group_end = (static_cast<std::uint64_t>(page_id) / bits_per_map_ + 1) * bits_per_map_;
+        reserved_end_ = static_cast<std::uint32_t>(std::min<std::uint64_t>(file_size_ / page_size_, group_end));
+    }
+    write_bitmaps();
+    if (new_group) write_superblock();
     return page_id;
 
     /*分配新页：
-    如果有空闲页（之前释放的），就复用。
-    否则，分配新页（增加 next_page_id_，并扩展文件）。
-    保存元数据。
+    如果有空闲页（之前释放的），就复用（打洞清零）。
+    否则，从当前 extent 取下一页（增加 next_page_id_；extent 用尽时整块扩展文件；必要时新增位图分组）。
+    在位图中置位，页号交给调用方之前已在磁盘上标记为已用，崩溃后重启不会把表已占用的页当成空闲页
+    再分出去：复用的页立即写回位图页；新页每个 extent 只写一次位图（整段预留标记为已用，崩溃时最多
+    泄漏一个 extent 的未用页）。超级块只在新增分组时立即写，next_page_id 重启时由位图推出。
     返回新页 ID。*/
 }
 
 //释放页
 void DiskManager::free_page(std::uint32_t page_id) {
-    free_list_.push_back(page_id);//在 vector 的末尾添加一个元素
-    save_meta();//保存新的元数据
-}
-
-void DiskManager::read_page(std::uint32_t page_id, void* out_buffer, std::size_t size) {
-    if (size != PAGE_SIZE) throw std::invalid_argument("size must be PAGE_SIZE");
-    std::ifstream ifs(db_path_, std::ios::binary);
-    if (!ifs) throw std::runtime_error("Failed to open db file for read");
-
-    std::uint64_t offset = static_cast<std::uint64_t>(page_id) * PAGE_SIZE;
-    ifs.seekg(0, std::ios::end);
-    std::uint64_t file_size = static_cast<std::uint64_t>(ifs.tellg());
-    if (offset + PAGE_SIZE > file_size) throw std::out_of_range("Page does not exist");
-    ifs.seekg(offset);
-    ifs.read(reinterpret_cast<char*>(out_buffer), static_cast<std::streamsize>(PAGE_SIZE));
-    if (ifs.gcount() != static_cast<std::streamsize>(PAGE_SIZE))
+    free_pages({page_id});
+}
+
+void DiskManager::free_pages(const std::vector<std::uint32_t>& page_ids) {
+    std::lock_guard<std::mutex> lk(space_mu_);
+    // 先校验整批：有非法页号时一页都不释放
+    for (auto page_id : page_ids) {
+        if (page_id >= next_page_id_ || page_id == SUPERBLOCK_PAGE ||
+            page_id == bitmap_page_of(page_id / bits_per_map_)) {
+            throw std::invalid_argument("free_page: invalid page id " + std::to_string(page_id));
+        }
+    }
+    for (auto page_id : page_ids) {
+        if (!test_bit(page_id)) continue; // 已空闲，忽略重复释放
+        set_bit(page_id, false);
+        free_list_.push_back(page_id);
+    }
+    // 与分配一样写穿；一批页只写一次各自所在的位图页
+    write_bitmaps();
+}
+
+bool DiskManager::is_allocated(std::uint32_t page_id) {
+    std::lock_guard<std::mutex> lk(space_mu_);
+    if (page_id >= next_page_id_ || page_id == SUPERBLOCK_PAGE ||
+        page_id == bitmap_page_of(page_id / bits_per_map_)) {
+        return false;
+    }
+    return test_bit(page_id);
+}
+
+void DiskManager::read_page(std::uint32_t page_id, void* out_buffer) {
+    std::uint64_t offset = static_cast<std::uint64_t>(page_id) * page_size_;
+    if (offset + page_size_ > file_size_) throw std::out_of_range("Page does not exist");
+    if (direct_io_ && !AlignedBuffer::is_aligned(out_buffer)) {
+        AlignedBuffer bounce(page_size_);
+        read_page(page_id, bounce.data());
+        std::memcpy(out_buffer, bounce.data(), page_size_);
+        return;
+    }
+    if (pread_full(fd_, out_buffer, page_size_, offset) != page_size_)
         throw std::runtime_error("Short read");
     /*
-    读页
-    参数：page_id 目标页号, out_buffer, 接受数据的缓冲区, size大小
-    1.size? 大小必须与PAGE_SIZE相等
-    2.以二进制读模式打开文件
-    3.计算偏移量，确定文件的写入位置。offset = page_id * PAGE_SIZE
-    4.检查页是否越界
-    5.定位到页起始位置
-    6.读取数据
-    7.检查是否读取完整
+    读页：一次 pread 完成，长度为本库的页大小
+    1.offset = page_id * page_size_，按缓存的文件大小检查页是否越界
+    2.定位读取并检查是否读取完整
     */
 }
 
-void DiskManager::write_page(std::uint32_t page_id, const void* buffer, std::size_t size) {
-    if (size != PAGE_SIZE) throw std::invalid_argument("size must be PAGE_SIZE");
-    ensure_file_size_for(page_id);
-    std::fstream fs(db_path_, std::ios::binary | std::ios::in | std::ios::out);
-    if (!fs) throw std::runtime_error("Failed to open db file for write");
-    std::uint64_t offset = static_cast<std::uint64_t>(page_id) * PAGE_SIZE;
-    fs.seekp(static_cast<std::streamoff>(offset));
-    fs.write(reinterpret_cast<const char*>(buffer), static_cast<std::streamsize>(PAGE_SIZE));
-    fs.flush();
+void DiskManager::write_page(std::uint32_t page_id, const void* buffer) {
+    std::uint64_t offset = static_cast<std::uint64_t>(page_id) * page_size_;
+    if (direct_io_ && !AlignedBuffer::is_aligned(buffer)) {
+        AlignedBuffer bounce(page_size_);
+        std::memcpy(bounce.data(), buffer, page_size_);
+        write_page(page_id, bounce.data());
+        return;
+    }
+    pwrite_full(fd_, buffer, page_size_, offset);
+    // 写到文件末尾之后会隐式扩展文件（中间的空洞读出为 0）；并发写者之间取最大值
+    std::uint64_t end = offset + page_size_;
+    std::uint64_t cur = file_size_.load();
+    while (cur < end && !file_size_.compare_exchange_weak(cur, end)) {}
     /*
-    写页（大致理解）
-    参数：page_id 目标页号, buffer 指向内存中页数据的指针, 缓冲区大小
-    1.size? 大小必须与PAGE_SIZE相等
-    2.确保文件足够大，若不足则扩展。
-    3.以二进制读写模式打开文件
-    4.计算偏移量，确定文件的写入位置。offset = page_id * PAGE_SIZE
-    5.定位写入位置
-    6.写入数据到输出流缓冲区
-    7.刷新缓冲区，确保数据写入磁盘。
+    写页：一次 pwrite 完成，不再每次打开/关闭文件
+    数据写入内核页缓存；持久化由操作系统回写（与原先 fstream::flush 语义一致）
     */
 }
 
+AsyncIoEngine& DiskManager::aio() {
+    std::call_once(aio_once_, [&]{ aio_ = AsyncIoEngine::create(fd_, page_size_, io_backend_, io_threads_); });
+    return *aio_;
+}
+
+const char* DiskManager::io_backend_name() {
+    return aio().name();
+}
+
+std::shared_ptr<IoBatch> DiskManager::submit_async(std::vector<IoRequest> reqs) {
+    // 边界检查与文件扩展在提交线程上同步完成，引擎只负责定位读写
+    for (const auto& r : reqs) {
+        if (direct_io_ && !AlignedBuffer::is_aligned(r.buffer)) {
+            throw std::invalid_argument("direct I/O requires aligned page buffers");
+        }
+        std::uint64_t end = (static_cast<std::uint64_t>(r.page_id) + 1) * page_size_;
+        if (r.op == IoRequest::Op::Read) {
+            if (end > file_size_) throw std::out_of_range("Page does not exist");
+        } else if (end > file_size_) {
+            std::lock_guard<std::mutex> lk(space_mu_);
+            ensure_file_size_for(r.page_id);
+        }
+    }
+    return aio().submit(std::move(reqs));
+}
+
 } // namespace pcsql
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "storage/free_space_map.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace pcsql {
+
+FreeSpaceMap::FreeSpaceMap(std::size_t page_size) : step_(page_size / CATEGORIES) {
+    if (step_ == 0) throw std::invalid_argument("page size too small for the free space map");
+}
+
+std::uint8_t FreeSpaceMap::category(std::size_t free_bytes) const {
+    return static_cast<std::uint8_t>(std::min(free_bytes / step_, CATEGORIES - 1));
+}
+
+void FreeSpaceMap::set_category(PageEntry& e, std::uint32_t page_id, std::uint8_t c) {
+    if (e.category == c) return;
+    auto& t = tables_[e.table_id];
+    t[e.category].erase(page_id);
+    t[c].insert(page_id);
+    e.category = c;
+}
+
+void FreeSpaceMap::update(std::int32_t table_id, std::uint32_t page_id, std::size_t free_bytes) {
+    std::uint8_t c = category(free_bytes);
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = entries_.find(page_id);
+    if (it != entries_.end() && it->second.table_id == table_id) {
+        set_category(it->second, page_id, c);
+        return;
+    }
+    if (it != entries_.end()) {
+        // 页已被释放并分给了别的表
+        tables_[it->second.table_id][it->second.category].erase(page_id);
+        entries_.erase(it);
+    }
+    entries_.emplace(page_id, PageEntry{table_id, c});
+    tables_[table_id][c].insert(page_id);
+}
+
+void FreeSpaceMap::refresh(std::uint32_t page_id, std::size_t free_bytes) {
+    std::uint8_t c = category(free_bytes);
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = entries_.find(page_id);
+    if (it != entries_.end()) set_category(it->second, page_id, c);
+}
+
+std::optional<std::uint32_t> FreeSpaceMap::find(std::int32_t table_id, std::size_t need) const {
+    // 类别按下取整记录，需要向上取整才能保证放得下；从最小的足够类别开始找（best fit，少产生碎片）
+    std::size_t first = (need + step_ - 1) / step_;
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = tables_.find(table_id);
+    if (it == tables_.end()) return std::nullopt;
+    for (std::size_t c = first; c < CATEGORIES; ++c) {
+        const auto& pages = it->second[c];
+        if (!pages.empty()) return *pages.begin();
+    }
+    return std::nullopt;
+}
+
+bool FreeSpaceMap::known(std::int32_t table_id, std::uint32_t page_id) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = entries_.find(page_id);
+    return it != entries_.end() && it->second.table_id == table_id;
+}
+
+void FreeSpaceMap::forget(std::int32_t table_id, std::uint32_t page_id) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = entries_.find(page_id);
+    if (it == entries_.end() || it->second.table_id != table_id) return;
+    tables_[table_id][it->second.category].erase(page_id);
+    entries_.erase(it);
+}
+
+void FreeSpaceMap::drop_table(std::int32_t table_id) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto t = tables_.find(table_id);
+    if (t == tables_.end()) return;
+    for (const auto& pages : t->second) {
+        for (auto pid : pages) entries_.erase(pid);
+    }
+    tables_.erase(t);
+}
+
+} // namespace pcsql
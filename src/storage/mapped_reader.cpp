@@ -0,0 +1,67 @@
+#include "storage/mapped_reader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "storage/disk_manager.hpp"
+
+namespace pcsql {
+
+static std::runtime_error map_error(const char* what) {
+    return std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+}
+
+MappedDiskReader::MappedDiskReader(const std::string& base_dir, const std::string& db_file)
+    : db_path_(std::filesystem::absolute(base_dir) / db_file) {
+    // 页大小以超级块为准（同时校验 magic/version）
+    page_size_ = DiskManager::probe_page_size(db_path_);
+    fd_ = ::open(db_path_.string().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) throw map_error("Failed to open db file");
+    struct stat st{};
+    if (::fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        throw map_error("Failed to stat db file");
+    }
+    size_ = static_cast<std::size_t>(st.st_size) / page_size_ * page_size_;
+    void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd_);
+        throw map_error("mmap data.db failed");
+    }
+    base_ = static_cast<const char*>(p);
+}
+
+MappedDiskReader::~MappedDiskReader() {
+    if (base_) ::munmap(const_cast<char*>(base_), size_);
+    if (fd_ >= 0) ::close(fd_);
+}
+
+const char* MappedDiskReader::page(std::uint32_t page_id) const {
+    std::uint64_t offset = static_cast<std::uint64_t>(page_id) * page_size_;
+    if (offset + page_size_ > size_) throw std::out_of_range("Page does not exist");
+    return base_ + offset;
+}
+
+void MappedDiskReader::read_page(std::uint32_t page_id, void* out_buffer) const {
+    std::memcpy(out_buffer, page(page_id), page_size_);
+}
+
+void MappedDiskReader::advise_sequential() const {
+    // 全表扫描：提示内核顺序预读并尽早回收已读页
+    ::madvise(const_cast<char*>(base_), size_, MADV_SEQUENTIAL);
+}
+
+void MappedDiskReader::advise_willneed(std::uint32_t first_page, std::uint32_t count) const {
+    std::uint64_t begin = static_cast<std::uint64_t>(first_page) * page_size_;
+    if (begin >= size_ || count == 0) return;
+    std::uint64_t len = std::min<std::uint64_t>(static_cast<std::uint64_t>(count) * page_size_, size_ - begin);
+    ::madvise(const_cast<char*>(base_ + begin), len, MADV_WILLNEED);
+}
+
+} // namespace pcsql
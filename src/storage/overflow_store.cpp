@@ -0,0 +1,82 @@
+#include "storage/overflow_store.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "storage/page_guard.hpp"
+
+namespace pcsql {
+
+OverflowRef OverflowStore::write(std::int32_t table_id, std::string_view value) {
+    if (value.empty() || value.size() > UINT32_MAX) throw std::invalid_argument("invalid overflow value size");
+    const std::size_t per_page = bytes_per_page();
+    // 先分配整条链，每页写入时就能带上下一页的页号
+    const std::size_t count = (value.size() + per_page - 1) / per_page;
+    std::vector<std::uint32_t> pages;
+    pages.reserve(count);
+    try {
+        while (pages.size() < count) {
+            pages.push_back(disk_.allocate_page());
+            buffer_.tag_page(pages.back(), PageKind::Overflow, table_id);
+        }
+        for (std::size_t i = 0; i < pages.size(); ++i) {
+            std::uint32_t next = i + 1 < pages.size() ? pages[i + 1] : 0;
+            std::size_t off = i * per_page;
+            auto used = static_cast<std::uint16_t>(std::min(per_page, value.size() - off));
+            WritePageGuard guard(buffer_, pages[i]);
+            char* p = guard.page().data.data();
+            std::memcpy(p, &next, sizeof(next));
+            std::memcpy(p + sizeof(next), &used, sizeof(used));
+            std::memcpy(p + HEADER, value.data() + off, used);
+        }
+    } catch (...) {
+        // 写到一半失败（如缓冲池帧全被 pin）：已分配的页交还磁盘，不留孤儿页
+        for (auto pid : pages) {
+            buffer_.discard_page(pid);
+            disk_.free_page(pid);
+        }
+        throw;
+    }
+    return OverflowRef{pages.front(), static_cast<std::uint32_t>(value.size())};
+}
+
+std::string OverflowStore::read(const OverflowRef& ref) const {
+    std::string out;
+    out.reserve(ref.length);
+    std::uint32_t pid = ref.first_page;
+    while (out.size() < ref.length) {
+        if (pid == 0) throw std::runtime_error("overflow chain ends early");
+        ReadPageGuard guard(buffer_, pid);
+        const char* p = guard.page().data.data();
+        std::uint16_t used = 0;
+        std::memcpy(&pid, p, sizeof(pid));
+        std::memcpy(&used, p + sizeof(pid), sizeof(used));
+        if (used == 0 || used > bytes_per_page()) throw std::runtime_error("corrupt overflow page");
+        out.append(p + HEADER, std::min<std::size_t>(used, ref.length - out.size()));
+    }
+    return out;
+}
+
+void OverflowStore::free(const OverflowRef& ref) {
+    std::uint32_t pid = ref.first_page;
+    std::size_t left = ref.length;
+    while (pid != 0 && left > 0) {
+        std::uint32_t next = 0;
+        std::uint16_t used = 0;
+        {
+            ReadPageGuard guard(buffer_, pid);
+            const char* p = guard.page().data.data();
+            std::memcpy(&next, p, sizeof(next));
+            std::memcpy(&used, p + sizeof(next), sizeof(used));
+        }
+        buffer_.discard_page(pid); // 页被复用为表页时表头无效，会重新初始化
+        disk_.free_page(pid);
+        if (used == 0) break; // 链已损坏：不再沿着它释放别的页
+        left -= std::min<std::size_t>(used, left);
+        pid = next;
+    }
+}
+
+} // namespace pcsql
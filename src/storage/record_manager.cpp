@@ -1,12 +1,18 @@
 #include "storage/record_manager.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
 #include <stdexcept>
+#include <system_error>
+#include <thread>
 
 namespace pcsql {
 
-void RecordManager::compact(Page& page) {
+void RecordManager::compact(Page& page, bool trim_slots) {
     /*将槽放入live中排序，更新槽的位置，将分散的槽变紧凑
     不改变槽（slot）在槽表中的索引位置，只改变每个槽记录的 off；因此外部对某个 slot_id 的引用在 compact 后仍然是有效的*/
     ensure_initialized(page);//确保 page 的 header/metadata 已正确初始化
@@ -17,7 +23,7 @@ void RecordManager::compact(Page& page) {
     live.reserve(h.slot_count);
     for (std::uint16_t i = 0; i < h.slot_count; ++i) {
         Slot* s = slot_at(page, i);//定位某个槽在内存中的位置，s指向该槽
-        if (s->off >= 0 && s->len > 0) live.emplace_back(i, *s);
+        if (slot_live(s)) live.emplace_back(i, *s);
     }
     // Sort by offset increasing 将活记录按数据在页面中当前的偏移 off 从小到大排序。
     std::sort(live.begin(), live.end(), [](auto& a, auto& b){ return a.second.off < b.second.off; });
@@ -25,177 +31,679 @@ void RecordManager::compact(Page& page) {
     // Move records to be tightly packed after Header
     std::uint16_t off = static_cast<std::uint16_t>(sizeof(Header));
     for (auto& [idx, s] : live) {
-        if (static_cast<std::uint16_t>(s.off) != off) {
+        if (s.off != off) {
             // move
-            std::memmove(page.data.data() + off, page.data.data() + s.off, s.len);
+            std::memmove(page.data.data() + off, page.data.data() + s.off, slot_len(&s));
             Slot* cur = slot_at(page, idx);
-            cur->off = static_cast<std::int16_t>(off);
+            cur->off = off;
         }
-        off = static_cast<std::uint16_t>(off + s.len);
+        off = static_cast<std::uint16_t>(off + slot_len(&s));
     }
     h.free_off = off;
+    if (trim_slots) trim_dead_slots(page);
     // 对单页进行碎片整理（compact/defragment）。目的是把页内所有“存活记录”紧凑地移动到页头（Header 之后），释放连续的空闲空间放在末尾。
 }
 
 RID RecordManager::insert(std::int32_t table_id, const char* data, std::size_t size) {
     //插入一条记录到指定表 table_id，返回 RID（页 id + 槽 id）
-    if (size > UINT16_MAX) throw std::invalid_argument("record too large");
-    // Find a page in table with enough free space, or allocate a new page
+    check_record_size(size);
+    return insert_flagged(table_id, data, size, 0);
+}
+
+RID RecordManager::insert_flagged(std::int32_t table_id, const char* data, std::size_t size, std::uint16_t flags) {
+    std::size_t need = sizeof(Slot) + size;//计算需要的空间
+    // 1) 空闲空间映射中放得下的页。记录可能过时：放不下时 try_place 已把它更正为更小的类别，
+    //    同一页不会被再次选中，循环必然结束
+    while (auto pid = fsm_.find(table_id, need)) {
+        if (auto rid = try_place(table_id, *pid, data, size, flags)) return *rid;
+    }
+    // 2) 映射还没见过表的最后一页（如重启后）：追加插入多半落在这里
     const auto& pages = tables_.get_table_pages(table_id);//获取该表已分配的页面列表
-    for (auto pid : pages) {
-        Page& page = buffer_.get_page(pid);
-        ensure_initialized(page);//确保页元数据存在
-        std::size_t need = sizeof(Slot) + size;//计算需要的空间
-        if (free_space(page) >= need) {//空闲空间足够
-            auto& h = header(page);//获取header
-            Slot* s = slot_at(page, h.slot_count);//s指向第一个空槽
-            // Place record at h.free_off
-            std::uint16_t rec_off = h.free_off;
-            std::memcpy(page.data.data() + rec_off, data, size);
-            s->off = static_cast<std::int16_t>(rec_off);
-            s->len = static_cast<std::uint16_t>(size);
-            RID rid{pid, h.slot_count};
-            h.slot_count += 1;
-            h.free_off = static_cast<std::uint16_t>(rec_off + size);
-            buffer_.unpin_page(pid, true);
-            tables_.save();//持久化表元数据变更
-            return rid;
-        }
-        //空间不够
-        buffer_.unpin_page(pid, false);
-    }
-    // No space found; allocate a new page for the table
-    std::uint32_t new_pid = tables_.allocate_table_page(table_id, disk_);//给表分配新页
-
-    Page& page = buffer_.get_page(new_pid);//？？？
-    ensure_initialized(page);
-    auto& h = header(page);
-    Slot* s = slot_at(page, h.slot_count);
+    if (!pages.empty() && !fsm_.known(table_id, pages.back())) {
+        if (auto rid = try_place(table_id, pages.back(), data, size, flags)) return *rid;
+    }
+    // 3) 分配新页（只有这时才持久化表元数据）
+    std::uint32_t new_pid = allocate_page(table_id);//给表分配新页
+    auto rid = try_place(table_id, new_pid, data, size, flags);
+    if (!rid) throw std::logic_error("record does not fit an empty page");
+    return *rid;
+}
+
+void RecordManager::check_record_size(std::size_t size) const {
+    if (size > MAX_RECORD || sizeof(Header) + sizeof(Slot) + size > buffer_.page_size()) {
+        throw std::invalid_argument("record too large");
+    }
+}
+
+std::vector<RID> RecordManager::insert_batch(std::int32_t table_id, const std::string_view* rows, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) check_record_size(rows[i].size());
+    std::vector<RID> out;
+    out.reserve(count);
+    bool added_pages = false;
+    try {
+        std::size_t i = 0;
+        while (i < count) {
+            // 与 insert 相同的选页顺序：映射中放得下的页 -> 未见过的最后一页 -> 新页
+            std::size_t need = sizeof(Slot) + rows[i].size();
+            std::uint32_t pid;
+            const auto& pages = tables_.get_table_pages(table_id);
+            if (auto p = fsm_.find(table_id, need)) {
+                pid = *p;
+            } else if (!pages.empty() && !fsm_.known(table_id, pages.back())) {
+                pid = pages.back();
+            } else {
+                pid = allocate_page(table_id, false);
+                added_pages = true;
+            }
+            // 一次 pin 连续装入尽可能多的行；放不下的页在映射中被更正，不会再被选中
+            WritePageGuard guard(buffer_, pid);
+            ensure_initialized(guard);
+            while (i < count && free_space(guard.view()) >= sizeof(Slot) + rows[i].size()) {
+                out.push_back(place_record(guard, rows[i].data(), rows[i].size()));
+                ++i;
+            }
+            fsm_.update(table_id, pid, free_space(guard.view()));
+        }
+    } catch (...) {
+        if (added_pages) tables_.save();
+        throw;
+    }
+    if (added_pages) tables_.save(); // 整批只写一次表元数据
+    return out;
+}
+
+std::optional<RID> RecordManager::try_place(std::int32_t table_id, std::uint32_t page_id,
+                                            const char* data, std::size_t size, std::uint16_t flags) {
+    WritePageGuard guard(buffer_, page_id);
+    ensure_initialized(guard);//确保页元数据存在
+    std::optional<RID> rid;
+    if (free_space(guard.view()) >= sizeof(Slot) + size) rid = place_record(guard, data, size, flags);
+    //放不下：guard 析构时解闩并 unpin（未修改则不置脏）
+    fsm_.update(table_id, page_id, free_space(guard.view()));
+    return rid;
+}
 
+std::uint32_t RecordManager::allocate_page(std::int32_t table_id, bool persist) {
+    std::uint32_t pid = tables_.allocate_table_page(table_id, disk_, persist);//persist 时保存 tables.meta
+    buffer_.tag_page(pid, page_kind(table_id), table_id);
+    fsm_.update(table_id, pid, buffer_.page_size() - sizeof(Header));
+    return pid;
+}
+
+RID RecordManager::place_record(WritePageGuard& guard, const char* data, std::size_t size, std::uint16_t flags) {
+    // 记录放在 free_off 处；优先复用已删除的槽，没有才在槽表末尾追加（调用方已按追加槽的需求确认空间足够）
+    Page& page = guard.page();
+    auto& h = header(page);//获取header
+    std::uint16_t slot = h.slot_count;
+    for (std::uint16_t i = 0; i < h.slot_count; ++i) {
+        if (!slot_live(slot_at(page, i))) { slot = i; break; }
+    }
+    Slot* s = slot_at(page, slot);
     std::uint16_t rec_off = h.free_off;
     std::memcpy(page.data.data() + rec_off, data, size);
-    s->off = static_cast<std::int16_t>(rec_off);
-    s->len = static_cast<std::uint16_t>(size);
-    RID rid{new_pid, h.slot_count};
-    h.slot_count += 1;
+    s->off = rec_off;
+    s->len = static_cast<std::uint16_t>(size | flags);
+    if (slot == h.slot_count) h.slot_count += 1;
     h.free_off = static_cast<std::uint16_t>(rec_off + size);
-    buffer_.unpin_page(new_pid, true);
-    tables_.save();
-    return rid;
+    return RID{guard.page_id(), slot};
 }
 
-bool RecordManager::read(const RID& rid, std::string& out) {
-    Page& page = buffer_.get_page(rid.page_id);
-    ensure_initialized(page);
+void RecordManager::trim_dead_slots(Page& page) {
+    // 槽表末尾的死槽直接收回，其 4 字节归还给空闲区；中间的死槽留给 place_record 复用
+    auto& h = header(page);
+    while (h.slot_count > 0 && !slot_live(slot_at(page, static_cast<std::uint16_t>(h.slot_count - 1)))) {
+        h.slot_count -= 1;
+    }
+    if (h.slot_count == 0) h.free_off = static_cast<std::uint16_t>(sizeof(Header)); // 整页已空：数据区也全部收回
+}
+
+std::uint8_t RecordManager::forward_info(const Page& page, const Slot* s, RID& other) {
+    if (!slot_redirect(s) || slot_len(s) < FWD_HEADER) return 0;
+    const char* p = page.data.data() + s->off;
+    std::uint8_t kind = static_cast<std::uint8_t>(p[0]);
+    if (kind != FWD_STUB && kind != FWD_MOVED) return 0;
+    std::memcpy(&other.page_id, p + 1, sizeof(other.page_id));
+    std::memcpy(&other.slot_id, p + 1 + sizeof(other.page_id), sizeof(other.slot_id));
+    return kind;
+}
+
+std::string RecordManager::forward_bytes(std::uint8_t kind, const RID& other, const char* data, std::size_t size) {
+    std::string out(FWD_HEADER + size, '\0');
+    out[0] = static_cast<char>(kind);
+    std::memcpy(&out[1], &other.page_id, sizeof(other.page_id));
+    std::memcpy(&out[1 + sizeof(other.page_id)], &other.slot_id, sizeof(other.slot_id));
+    if (size) std::memcpy(&out[FWD_HEADER], data, size);
+    return out;
+}
+
+const RecordManager::Slot* RecordManager::moved_copy(const Page& page, const RID& copy, const RID& home) {
     const auto& h = header(page);
-    if (rid.slot_id >= h.slot_count) { buffer_.unpin_page(rid.page_id, false); return false; }
-    const Slot* s = slot_at(page, rid.slot_id);
-    //获取槽指针
-    if (s->off < 0 || s->len == 0) { buffer_.unpin_page(rid.page_id, false); return false; }
-    // 额外的边界检查，防止越界读取
-    if (static_cast<std::size_t>(s->off) < sizeof(Header) || static_cast<std::size_t>(s->off) + s->len > PAGE_SIZE) {
-        buffer_.unpin_page(rid.page_id, false);
-        return false;
-    }
-    out.assign(page.data.data() + s->off, page.data.data() + s->off + s->len);
-    buffer_.unpin_page(rid.page_id, false);
+    if (!header_valid(h, page.data.size()) || copy.slot_id >= h.slot_count) return nullptr;
+    const Slot* s = slot_at(page, copy.slot_id);
+    RID back;
+    if (!slot_live(s) || !slot_in_bounds(page, s) || forward_info(page, s, back) != FWD_MOVED) return nullptr;
+    return back.page_id == home.page_id && back.slot_id == home.slot_id ? s : nullptr;
+}
+
+bool RecordManager::read(const RID& rid, std::string& out) {
+    RID copy;
+    {
+        ReadPageGuard guard(buffer_, rid.page_id);
+        const Page& page = guard.page();
+        const auto& h = header(page);
+        if (!header_valid(h, page.data.size())) return false; // 未初始化的页没有记录
+        if (rid.slot_id >= h.slot_count) return false;
+        const Slot* s = slot_at(page, rid.slot_id);
+        //获取槽指针
+        if (!slot_live(s)) return false;
+        // 额外的边界检查，防止越界读取
+        if (!slot_in_bounds(page, s)) return false;
+        if (!slot_redirect(s)) {
+            out.assign(page.data.data() + s->off, page.data.data() + s->off + slot_len(s));
+            return true;
+        }
+        // 转发桩：记录已搬到别的页；搬走的副本本身不对外暴露 RID
+        if (forward_info(page, s, copy) != FWD_STUB) return false;
+    }
+    ReadPageGuard guard(buffer_, copy.page_id);
+    const Page& page = guard.page();
+    const Slot* m = moved_copy(page, copy, rid);
+    if (!m) return false;
+    out.assign(page.data.data() + m->off + FWD_HEADER, page.data.data() + m->off + slot_len(m));
     return true;
 }
 
-bool RecordManager::update(const RID& rid, const char* data, std::size_t size) {
-    //更新有问题待处理
-    if (size > UINT16_MAX) return false;
-    Page& page = buffer_.get_page(rid.page_id);
-    ensure_initialized(page);
+bool RecordManager::fits_after_compact(const Page& page, std::uint16_t slot, std::size_t size) {
+    // 压缩后可用空间 = 当前空闲 + 其他槽之间的碎片
+    const auto& h = header(page);
+    std::size_t live_bytes = 0;
+    for (std::uint16_t i = 0; i < h.slot_count; ++i) {
+        const Slot* o = slot_at(page, i);
+        if (i != slot && slot_live(o)) live_bytes += slot_len(o);
+    }
+    std::size_t slots_bytes = static_cast<std::size_t>(h.slot_count) * sizeof(Slot);
+    return sizeof(Header) + live_bytes + slots_bytes + size <= page.data.size();
+}
+
+bool RecordManager::rewrite_slot(WritePageGuard& guard, std::uint16_t slot, const char* data, std::size_t size,
+                                 std::uint16_t flags) {
+    {
+        // 1)~3) 都可能失败而不修改页：先判断能否成功，再取可写访问（置脏）
+        const Page& view = guard.view();
+        const auto& h = header(view);
+        const Slot* s = slot_at(view, slot);
+        bool fits_in_place = size <= slot_len(s);
+        bool extends_tail = static_cast<std::uint16_t>(s->off + slot_len(s)) == h.free_off &&
+                            free_space(view) + slot_len(s) >= size;
+        if (!fits_in_place && !extends_tail && !fits_after_compact(view, slot, size)) return false;
+    }
+
+    Page& page = guard.page();
     auto& h = header(page);
-    if (rid.slot_id >= h.slot_count) { buffer_.unpin_page(rid.page_id, false); return false; }
-    Slot* s = slot_at(page, rid.slot_id);
-    if (s->off < 0 || s->len == 0) { buffer_.unpin_page(rid.page_id, false); return false; }
-    // 边界检查
-    if (static_cast<std::size_t>(s->off) < sizeof(Header) || static_cast<std::size_t>(s->off) + s->len > PAGE_SIZE) {
-        buffer_.unpin_page(rid.page_id, false);
-        return false;
-    }
-    if (size <= s->len) {//如果新数据大小 size 小于等于现有记录长度 s->len，直接覆盖现有记录开始位置
+    Slot* s = slot_at(page, slot);
+    const std::uint16_t len = static_cast<std::uint16_t>(size | flags);
+    if (size <= slot_len(s)) {//如果新数据大小 size 小于等于现有记录长度，直接覆盖现有记录开始位置
         std::memcpy(page.data.data() + s->off, data, size);
-        s->len = static_cast<std::uint16_t>(size);
-        buffer_.unpin_page(rid.page_id, true);
+        s->len = len;
         return true;
     }
 
     // 2) 若记录位于数据区尾部，且有足够连续空闲，则原地扩展
-    if (static_cast<std::uint16_t>(s->off + s->len) == h.free_off) {
-        std::size_t need_extra = size - s->len;
-        if (free_space(page) >= need_extra) {
-            std::memcpy(page.data.data() + s->off, data, size);
-            s->len = static_cast<std::uint16_t>(size);
-            h.free_off = static_cast<std::uint16_t>(s->off + s->len);
-            buffer_.unpin_page(rid.page_id, true);
-            return true;
-        }
+    if (static_cast<std::uint16_t>(s->off + slot_len(s)) == h.free_off && free_space(page) + slot_len(s) >= size) {
+        std::memcpy(page.data.data() + s->off, data, size);
+        s->len = len;
+        h.free_off = static_cast<std::uint16_t>(s->off + size);
+        return true;
     }
 
-    // 3) 无法原地扩展：执行一次压缩，获得连续尾部空闲，然后将记录搬迁到页尾
-    compact(page);
+    // 3) 无法原地扩展：旧记录先作废再压缩，获得连续尾部空闲，然后将记录搬迁到页尾
+    s->off = DELETED_OFF; s->len = 0;
+    compact(page, false);
     auto& h2 = header(page);
-    Slot* s2 = slot_at(page, rid.slot_id);
-
-    if (free_space(page) >= size) {
-        std::uint16_t new_off = h2.free_off;
-        std::memcpy(page.data.data() + new_off, data, size);
-        s2->off = static_cast<std::int16_t>(new_off);
-        s2->len = static_cast<std::uint16_t>(size);
-        h2.free_off = static_cast<std::uint16_t>(new_off + size);
-        buffer_.unpin_page(rid.page_id, true);
-        return true;
-    }
+    Slot* s2 = slot_at(page, slot);
+    std::uint16_t new_off = h2.free_off;
+    std::memcpy(page.data.data() + new_off, data, size);
+    s2->off = new_off;
+    s2->len = len;
+    h2.free_off = static_cast<std::uint16_t>(new_off + size);
+    return true;
+}
 
-    // 4) 仍然不足：失败，交由上层做删除+重新插入策略
-    buffer_.unpin_page(rid.page_id, false);
-    return false;
+bool RecordManager::update(const RID& rid, const char* data, std::size_t size) {
+    if (size > MAX_RECORD) return false;
+    std::optional<RID> copy; // rid 已是转发桩时，当前副本的位置
+    {
+        WritePageGuard guard(buffer_, rid.page_id);
+        ensure_initialized(guard);
+        const Page& view = guard.view();
+        if (rid.slot_id >= header(view).slot_count) return false;
+        const Slot* s = slot_at(view, rid.slot_id);
+        if (!slot_live(s) || !slot_in_bounds(view, s)) return false;
+        if (!slot_redirect(s)) {
+            if (rewrite_slot(guard, rid.slot_id, data, size, 0)) {
+                fsm_.refresh(rid.page_id, free_space(guard.view()));
+                return true;
+            }
+            // 本页放不下：记录搬走后原槽要留转发桩，桩也放不下就只能失败
+            if (!fits_after_compact(view, rid.slot_id, FWD_HEADER)) return false;
+        } else {
+            RID other;
+            if (forward_info(view, s, other) != FWD_STUB) return false; // 搬走的副本只能经由桩访问
+            copy = other;
+        }
+    }
+    // 一次只持有一页的写闩：先处理副本/新页，再回到原页改桩
+    std::string moved = forward_bytes(FWD_MOVED, rid, data, size);
+    if (copy) {
+        // 1) 副本所在页放得下：原地改写，桩不变
+        WritePageGuard guard(buffer_, copy->page_id);
+        if (!moved_copy(guard.view(), *copy, rid)) return false;
+        if (rewrite_slot(guard, copy->slot_id, moved.data(), moved.size(), REDIRECT)) {
+            fsm_.refresh(copy->page_id, free_space(guard.view()));
+            return true;
+        }
+    }
+    // 2) 搬到表内其他有空间的页（链最多一跳：再次搬迁时改写桩并删除旧副本）
+    std::int32_t table_id = tables_.page_owner(rid.page_id);
+    if (table_id < 0 || sizeof(Header) + sizeof(Slot) + moved.size() > buffer_.page_size()) return false;
+    RID target = insert_flagged(table_id, moved.data(), moved.size(), REDIRECT);
+    {
+        WritePageGuard guard(buffer_, rid.page_id);
+        std::string stub = forward_bytes(FWD_STUB, target, nullptr, 0);
+        if (!rewrite_slot(guard, rid.slot_id, stub.data(), stub.size(), REDIRECT)) {
+            guard.release();
+            WritePageGuard undo(buffer_, target.page_id);
+            tombstone(undo, target.slot_id);
+            return false;
+        }
+        fsm_.refresh(rid.page_id, free_space(guard.view()));
+    }
+    if (copy) {
+        WritePageGuard guard(buffer_, copy->page_id);
+        tombstone(guard, copy->slot_id);
+    }
+    return true;
 }
 
-bool RecordManager::erase(const RID& rid) {
-    //需要注意槽表随时间增长会导致页尾槽区膨胀，可能需要一个专门机制回收空槽索引
-    //删除不完备，需要补充
-    Page& page = buffer_.get_page(rid.page_id);
-    ensure_initialized(page);
-    auto& h = header(page);
-    if (rid.slot_id >= h.slot_count) { buffer_.unpin_page(rid.page_id, false); return false; }
-    Slot* s = slot_at(page, rid.slot_id);
-    if (s->off < 0 || s->len == 0) { buffer_.unpin_page(rid.page_id, false); return false; }
-    s->off = -1; s->len = 0; // tombstone 标记为无效
+void RecordManager::tombstone(WritePageGuard& guard, std::uint16_t slot) {
+    Page& page = guard.page();
+    Slot* s = slot_at(page, slot);
+    s->off = DELETED_OFF; s->len = 0; // tombstone 标记为无效
+    trim_dead_slots(page);
     // optional: compact if lots of garbage; here simple heuristic
-    if (free_space(page) < PAGE_SIZE / 4) {
+    if (free_space(page) < page.data.size() / 4) {
         compact(page);
     }
-    buffer_.unpin_page(rid.page_id, true);
+    fsm_.refresh(guard.page_id(), free_space(page));
+}
+
+bool RecordManager::erase(const RID& rid) {
+    //槽表不会无限膨胀：末尾死槽在删除/压缩时收回，中间的死槽由后续插入复用
+    RID copy;
+    {
+        WritePageGuard guard(buffer_, rid.page_id);
+        ensure_initialized(guard);
+        const Page& view = guard.view();
+        if (rid.slot_id >= header(view).slot_count) return false;
+        const Slot* s = slot_at(view, rid.slot_id);
+        if (!slot_live(s)) return false;
+        if (!slot_redirect(s)) {
+            tombstone(guard, rid.slot_id);
+            return true;
+        }
+        if (forward_info(view, s, copy) != FWD_STUB) return false; // 搬走的副本只能经由桩删除
+        tombstone(guard, rid.slot_id);
+    }
+    WritePageGuard guard(buffer_, copy.page_id);
+    if (moved_copy(guard.view(), copy, rid)) tombstone(guard, copy.slot_id);
     return true;
 }
 
-std::vector<std::pair<RID, std::string>> RecordManager::scan(std::int32_t table_id) {
-    std::vector<std::pair<RID, std::string>> out;
-    const auto& pages = tables_.get_table_pages(table_id);
+VacuumStats RecordManager::vacuum(std::int32_t table_id, const MoveFn& moved) {
+    VacuumStats stats;
+    const std::vector<std::uint32_t> pages = tables_.get_table_pages(table_id);
+    const std::size_t page_size = buffer_.page_size();
+    stats.pages_before = pages.size();
+
+    // 1) 收拢转发桩：原页又放得下时搬回原槽（RID 不变），否则副本就地转为普通记录，RID 改为副本位置
+    std::vector<std::pair<RID, RID>> stubs; // home -> copy
     for (auto pid : pages) {
-        Page& page = buffer_.get_page(pid);
-        ensure_initialized(page);
+        ReadPageGuard guard(buffer_, pid);
+        const Page& page = guard.page();
         const auto& h = header(page);
-        // 安全打印，帮助定位可能的卡住位置
-        // std::cout << "[RecordManager::scan] pid=" << pid << ", slot_count=" << h.slot_count << ", free_off=" << h.free_off << std::endl;
+        if (!header_valid(h, page.data.size())) continue;
         for (std::uint16_t i = 0; i < h.slot_count; ++i) {
             const Slot* s = slot_at(page, i);
-            // 过滤非法槽，避免越界/异常分配
-            if (s->off >= 0 && s->len > 0) {
-                if (static_cast<std::size_t>(s->off) >= sizeof(Header) && static_cast<std::size_t>(s->off) + s->len <= PAGE_SIZE) {
-                    out.emplace_back(RID{pid, i}, std::string(page.data.data() + s->off, s->len));
-                } else {
-                    // std::cout << "[RecordManager::scan] skip invalid slot pid=" << pid << ", i=" << i << ", off=" << s->off << ", len=" << s->len << std::endl;
-                }
+            RID copy;
+            if (slot_live(s) && slot_in_bounds(page, s) && forward_info(page, s, copy) == FWD_STUB) {
+                stubs.push_back({RID{pid, i}, copy});
+            }
+        }
+    }
+    for (const auto& [home, copy] : stubs) {
+        std::string row;
+        {
+            ReadPageGuard guard(buffer_, copy.page_id);
+            const Slot* m = moved_copy(guard.page(), copy, home);
+            if (!m) continue;
+            row.assign(guard.page().data.data() + m->off + FWD_HEADER, slot_len(m) - FWD_HEADER);
+        }
+        bool back_home;
+        {
+            WritePageGuard guard(buffer_, home.page_id);
+            back_home = rewrite_slot(guard, home.slot_id, row.data(), row.size(), 0);
+            if (back_home) fsm_.refresh(home.page_id, free_space(guard.view()));
+        }
+        if (back_home) {
+            WritePageGuard guard(buffer_, copy.page_id);
+            tombstone(guard, copy.slot_id);
+        } else {
+            {
+                WritePageGuard guard(buffer_, copy.page_id); // 去掉转发头，记录变短，原地改写必然成功
+                rewrite_slot(guard, copy.slot_id, row.data(), row.size(), 0);
+                fsm_.refresh(copy.page_id, free_space(guard.view()));
+            }
+            {
+                WritePageGuard guard(buffer_, home.page_id);
+                tombstone(guard, home.slot_id);
+            }
+            moved(home, copy, row);
+            ++stats.rows_moved;
+        }
+        ++stats.stubs_collapsed;
+    }
+
+    // 2) 合并稀疏页：从表尾往前，把不超过半满的页整页搬进更靠前、放得下的页；空页直接回收。
+    //    占用按压缩后计算（表头 + 槽表 + 存活记录），搬入的每行按新增一个槽保守估计
+    struct PageInfo {
+        std::size_t used{sizeof(Header)};
+        std::vector<std::pair<std::uint16_t, std::size_t>> rows; // slot -> len
+        bool fixed{false};  // 含转发槽或已接收搬入的行：不再清空
+        bool freed{false};
+    };
+    std::vector<PageInfo> info(pages.size());
+    for (std::size_t k = 0; k < pages.size(); ++k) {
+        ReadPageGuard guard(buffer_, pages[k]);
+        const Page& page = guard.page();
+        const auto& h = header(page);
+        if (!header_valid(h, page.data.size())) continue;
+        info[k].used += static_cast<std::size_t>(h.slot_count) * sizeof(Slot);
+        for (std::uint16_t i = 0; i < h.slot_count; ++i) {
+            const Slot* s = slot_at(page, i);
+            if (!slot_live(s) || !slot_in_bounds(page, s)) continue;
+            info[k].used += slot_len(s);
+            info[k].rows.emplace_back(i, slot_len(s));
+            if (slot_redirect(s)) info[k].fixed = true;
+        }
+    }
+    std::size_t first_open = 0; // 之前的页都已放不下任何一行
+    auto closed = [&](std::size_t k) {
+        return info[k].freed || info[k].rows.empty() || info[k].used + sizeof(Slot) >= page_size;
+    };
+    for (std::size_t j = pages.size(); j-- > 0;) {
+        PageInfo& src = info[j];
+        if (src.rows.empty()) {
+            src.freed = true;
+            continue;
+        }
+        if (src.fixed || src.used > page_size / 2) continue;
+        // 先按首次适应排好每行的去处，整页放得下才动手
+        while (first_open < j && closed(first_open)) ++first_open;
+        std::vector<std::size_t> target(src.rows.size());
+        std::map<std::size_t, std::size_t> added; // 目标页 -> 计划搬入的字节
+        bool fits = true;
+        for (std::size_t r = 0; r < src.rows.size() && fits; ++r) {
+            std::size_t need = sizeof(Slot) + src.rows[r].second;
+            fits = false;
+            for (std::size_t k = first_open; k < j; ++k) {
+                if (closed(k) || info[k].used + added[k] + need > page_size) continue;
+                added[k] += need;
+                target[r] = k;
+                fits = true;
+                break;
+            }
+        }
+        if (!fits) continue;
+        for (const auto& [k, bytes] : added) {
+            if (bytes == 0) continue; // 只是试探过的页
+            info[k].used += bytes;
+            info[k].fixed = true;
+        }
+        for (std::size_t r = 0; r < src.rows.size(); ++r) {
+            const RID from{pages[j], src.rows[r].first};
+            std::string row;
+            {
+                ReadPageGuard guard(buffer_, from.page_id);
+                const Slot* s = slot_at(guard.page(), from.slot_id);
+                row.assign(guard.page().data.data() + s->off, slot_len(s));
             }
+            RID to;
+            {
+                WritePageGuard guard(buffer_, pages[target[r]]);
+                if (free_space(guard.view()) < sizeof(Slot) + row.size()) compact(guard.page());
+                if (free_space(guard.view()) < sizeof(Slot) + row.size()) throw std::logic_error("vacuum: target page is full");
+                to = place_record(guard, row.data(), row.size());
+                fsm_.refresh(to.page_id, free_space(guard.view()));
+            }
+            {
+                WritePageGuard guard(buffer_, from.page_id);
+                tombstone(guard, from.slot_id);
+            }
+            moved(from, to, row);
+            ++stats.rows_moved;
         }
-        buffer_.unpin_page(pid, false);
+        src.freed = true;
+    }
+
+    // 3) 回收空页：先清零帧（空闲页被复用时不会带着旧槽表），再从页列表移除并交还 DiskManager
+    std::vector<std::uint32_t> freed;
+    for (std::size_t k = 0; k < pages.size(); ++k) {
+        if (!info[k].freed) continue;
+        buffer_.discard_page(pages[k]);
+        fsm_.forget(table_id, pages[k]);
+        freed.push_back(pages[k]);
+    }
+    tables_.release_table_pages(table_id, freed, disk_);
+
+    // 4) 重建剩余页的空闲空间映射并统计存活行
+    for (auto pid : tables_.get_table_pages(table_id)) {
+        ReadPageGuard guard(buffer_, pid);
+        const Page& page = guard.page();
+        const auto& h = header(page);
+        if (!header_valid(h, page.data.size())) {
+            fsm_.update(table_id, pid, page.data.size() - sizeof(Header));
+            continue;
+        }
+        fsm_.update(table_id, pid, free_space(page));
+        for (std::uint16_t i = 0; i < h.slot_count; ++i) {
+            const Slot* s = slot_at(page, i);
+            RID other;
+            if (slot_live(s) && (!slot_redirect(s) || forward_info(page, s, other) == FWD_STUB)) ++stats.live_rows;
+        }
+    }
+    stats.pages_after = tables_.get_table_pages(table_id).size();
+    return stats;
+}
+
+PageKind RecordManager::page_kind(std::int32_t table_id) const {
+    return tables_.get_table_name(table_id).rfind("sys_", 0) == 0 ? PageKind::Catalog : PageKind::Heap;
+}
+
+void RecordManager::tag_pages(std::int32_t table_id) {
+    PageKind kind = page_kind(table_id);
+    for (auto pid : tables_.get_table_pages(table_id)) buffer_.tag_page(pid, kind, table_id);
+}
+
+std::vector<std::pair<RID, std::string>> RecordManager::scan(std::int32_t table_id) {
+    std::vector<std::pair<RID, std::string>> out;
+    for (auto it = table_iterator(table_id); it.next();) {
+        out.emplace_back(it.rid(), std::string(it.record()));
     }
     return out;//读取一个表的全部内容
 }
 
+TableIterator::TableIterator(RecordManager& records, std::int32_t table_id)
+    : records_(&records), table_id_(table_id),
+      // 顺序扫描：后续页异步预读，扫过的页只在私有环中轮转，不挤占共享缓冲池的热点页
+      scan_(std::make_unique<ScanContext>(records.buffer_, records.tables_.get_table_pages(table_id))) {}
+
+TableIterator::TableIterator(RecordManager& records, std::int32_t table_id, std::vector<std::uint32_t> pages,
+                             std::size_t ring_size)
+    : records_(&records), table_id_(table_id),
+      scan_(std::make_unique<ScanContext>(records.buffer_, std::move(pages), ring_size)) {}
+
+bool TableIterator::next() {
+    using RM = RecordManager;
+    forward_.release();
+    for (;;) {
+        if (guard_) {
+            const Page& page = guard_.page();
+            while (slot_ < slot_count_) {
+                std::uint16_t i = slot_++;
+                const RM::Slot* s = RM::slot_at(page, i);
+                // 过滤非法槽，避免越界
+                if (!RM::slot_live(s) || !RM::slot_in_bounds(page, s)) continue;
+                RID home{guard_.page_id(), i};
+                if (!RM::slot_redirect(s)) {
+                    rid_ = home;
+                    record_ = std::string_view(page.data.data() + s->off, RM::slot_len(s));
+                    return true;
+                }
+                // 转发桩：在桩的位置（稳定 RID）返回搬走的副本；副本本身跳过，不重复返回
+                RID copy;
+                if (RM::forward_info(page, s, copy) != RM::FWD_STUB) continue;
+                const Page* cp = &page;
+                if (copy.page_id != home.page_id) {
+                    forward_ = ReadPageGuard(records_->buffer_, copy.page_id);
+                    cp = &forward_.page();
+                }
+                const RM::Slot* m = RM::moved_copy(*cp, copy, home);
+                if (!m) {
+                    forward_.release();
+                    continue;
+                }
+                rid_ = home;
+                record_ = std::string_view(cp->data.data() + m->off + RM::FWD_HEADER, RM::slot_len(m) - RM::FWD_HEADER);
+                return true;
+            }
+            guard_.release();
+        }
+        if (!scan_ || next_page_ >= scan_->pages().size()) {
+            close();
+            return false;
+        }
+        std::uint32_t pid = scan_->pages()[next_page_++];
+        guard_ = ReadPageGuard(records_->buffer_, pid, *scan_);
+        const Page& page = guard_.page();
+        const auto& h = RM::header(page);
+        if (!RM::header_valid(h, page.data.size())) { // 未初始化的页没有记录
+            records_->fsm_.update(table_id_, pid, page.data.size() - sizeof(RM::Header));
+            guard_.release();
+            continue;
+        }
+        records_->fsm_.update(table_id_, pid, RM::free_space(page)); // 顺便补全重启后空闲空间映射未见过的页
+        slot_ = 0;
+        slot_count_ = h.slot_count;
+    }
+}
+
+TableIterator& TableIterator::operator=(TableIterator&& o) noexcept {
+    if (this != &o) {
+        close();
+        records_ = o.records_;
+        table_id_ = o.table_id_;
+        scan_ = std::move(o.scan_);
+        next_page_ = o.next_page_;
+        guard_ = std::move(o.guard_);
+        forward_ = std::move(o.forward_);
+        slot_ = o.slot_;
+        slot_count_ = o.slot_count_;
+        rid_ = o.rid_;
+        record_ = std::exchange(o.record_, {});
+    }
+    return *this;
+}
+
+void TableIterator::close() {
+    forward_.release();
+    guard_.release();
+    scan_.reset();
+    record_ = {};
+}
+
+void RecordManager::run_morsels(std::int32_t table_id, std::vector<std::uint32_t> pages, std::size_t morsel_pages,
+                                std::size_t workers, const std::function<void(std::size_t, TableIterator&)>& fn) {
+    const std::size_t morsels = (pages.size() + morsel_pages - 1) / morsel_pages;
+    // 每个线程同时 pin 一到两页并占用扫描环：线程数不超过缓冲池的 1/4，也不超过 morsel 数
+    workers = std::clamp<std::size_t>(workers, 1, std::max<std::size_t>(1, buffer_.capacity() / 4));
+    workers = std::min(workers, morsels);
+    if (workers == 0) return;
+    // 各线程的扫描环合起来与一次串行扫描相当，不因并行而多挤占共享缓冲池
+    const std::size_t ring = std::max<std::size_t>(1, ScanContext::DEFAULT_RING / workers);
+    std::atomic<std::size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::mutex error_mu;
+    std::exception_ptr error;
+    auto work = [&] {
+        for (std::size_t m = next++; m < morsels && !failed.load(); m = next++) {
+            try {
+                auto first = pages.begin() + static_cast<std::ptrdiff_t>(m * morsel_pages);
+                auto last = pages.begin() + static_cast<std::ptrdiff_t>(std::min(pages.size(), (m + 1) * morsel_pages));
+                TableIterator it(*this, table_id, std::vector<std::uint32_t>(first, last), ring);
+                fn(m, it);
+            } catch (...) {
+                std::lock_guard<std::mutex> lk(error_mu);
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (std::size_t i = 1; i < workers; ++i) {
+        try { threads.emplace_back(work); } catch (const std::system_error&) { break; } // 建不了线程就少用几个
+    }
+    work();
+    for (auto& t : threads) t.join();
+    if (error) std::rethrow_exception(error);
+}
+
+void RecordManager::scan_mapped(const MappedDiskReader& map, std::int32_t table_id,
+                                const std::function<void(const RID&, std::string_view)>& fn) const {
+    constexpr std::size_t kPrefetch = 16; // 预取窗口（页）
+    const auto& pages = tables_.get_table_pages(table_id);
+    map.advise_sequential();
+    for (std::size_t n = 0; n < pages.size(); ++n) {
+        if (n % kPrefetch == 0) {
+            // 表的页号不一定连续：对接下来一个窗口内的页逐一 WILLNEED
+            for (std::size_t k = n; k < std::min(pages.size(), n + kPrefetch); ++k) map.advise_willneed(pages[k], 1);
+        }
+        std::uint32_t pid = pages[n];
+        // 直接把映射页包装成只读 Page 视图，复用槽位解析
+        Page page;
+        page.page_id = pid;
+        page.data = PageData(const_cast<char*>(map.page(pid)), map.page_size());
+        const Page& view = page;
+        const auto& h = header(view);
+        if (!header_valid(h, view.data.size())) continue; // 未初始化的页没有记录
+        for (std::uint16_t i = 0; i < h.slot_count; ++i) {
+            const Slot* s = slot_at(view, i);
+            if (!slot_live(s) || !slot_in_bounds(view, s)) continue;
+            if (!slot_redirect(s)) {
+                fn(RID{pid, i}, std::string_view(view.data.data() + s->off, slot_len(s)));
+                continue;
+            }
+            // 转发桩：同 TableIterator，在桩的 RID 处返回副本
+            RID copy;
+            if (forward_info(view, s, copy) != FWD_STUB || copy.page_id >= map.page_count()) continue;
+            Page other;
+            other.page_id = copy.page_id;
+            other.data = PageData(const_cast<char*>(map.page(copy.page_id)), map.page_size());
+            if (const Slot* m = moved_copy(other, copy, RID{pid, i})) {
+                fn(RID{pid, i}, std::string_view(other.data.data() + m->off + FWD_HEADER, slot_len(m) - FWD_HEADER));
+            }
+        }
+    }
+}
+
 } // namespace pcsql
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "storage/table_manager.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -86,17 +87,16 @@ std::int32_t TableManager::create_table(const std::string& name) {
 bool TableManager::drop_table_by_id(std::int32_t table_id, DiskManager& disk) {
     auto itn = id_to_name_.find(table_id);
     if (itn == id_to_name_.end()) return false;
-    // 回收所有页
+    std::vector<std::uint32_t> pages;
     auto itp = table_pages_.find(table_id);
-    if (itp != table_pages_.end()) {
-        for (auto pid : itp->second) disk.free_page(pid);
-    }//如果 table_pages_ 中有此 table_id 的页列表，则遍历每个 pid 并调用 disk.free_page(pid) 回收页面资源
-    // 再删除目录项
+    if (itp != table_pages_.end()) pages = std::move(itp->second);
+    // 先删除目录项并持久化，再回收所有页：中途崩溃只会泄漏页，不会让表引用已释放（可能被复用）的页
     std::string name = itn->second;
     id_to_name_.erase(itn);
     name_to_id_.erase(name);
     table_pages_.erase(table_id);
     save();
+    disk.free_pages(pages);
     return true;
 }
 
@@ -119,12 +119,20 @@ std::string TableManager::get_table_name(std::int32_t table_id) const {
     return it->second;
 }
 
-std::uint32_t TableManager::allocate_table_page(std::int32_t table_id, DiskManager& disk) {
+std::vector<std::int32_t> TableManager::table_ids() const {
+    std::vector<std::int32_t> ids;
+    ids.reserve(id_to_name_.size());
+    for (const auto& [id, name] : id_to_name_) ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+std::uint32_t TableManager::allocate_table_page(std::int32_t table_id, DiskManager& disk, bool persist) {
     auto it = id_to_name_.find(table_id);//首先确认 table_id 有对应的表（在 id_to_name_ 中）；如果不存在抛 invalid_argument
     if (it == id_to_name_.end()) throw std::invalid_argument("invalid table id");
     std::uint32_t pid = disk.allocate_page();//向 DiskManager 请求分配一个新页 pid = disk.allocate_page()（具体实现由 DiskManager 决定，可能是返回空闲页号）。
     table_pages_[table_id].push_back(pid);//将新页 id pid 添加到该表的页列表 table_pages_[table_id]（如果以前没有该键，operator[] 会创建一个空向量）。
-    save();
+    if (persist) save();
     return pid;
 }
 
@@ -138,4 +146,23 @@ const std::vector<std::uint32_t>& TableManager::get_table_pages(std::int32_t tab
     使用 const& 避免拷贝，便于调用端只读访问。*/
 }
 
+void TableManager::release_table_pages(std::int32_t table_id, const std::vector<std::uint32_t>& pages, DiskManager& disk) {
+    auto it = table_pages_.find(table_id);
+    if (it == table_pages_.end() || pages.empty()) return;
+    auto& list = it->second;
+    list.erase(std::remove_if(list.begin(), list.end(), [&](std::uint32_t pid) {
+        return std::find(pages.begin(), pages.end(), pid) != pages.end();
+    }), list.end());
+    // 先持久化页列表再释放：中途失败只会泄漏页，不会让表引用已释放的页
+    save();
+    disk.free_pages(pages);
+}
+
+std::int32_t TableManager::page_owner(std::uint32_t page_id) const {
+    for (const auto& [tid, pages] : table_pages_) {
+        if (std::find(pages.begin(), pages.end(), page_id) != pages.end()) return tid;
+    }
+    return -1;
+}
+
 } // namespace pcsql
\ No newline at end of file
@@ -0,0 +1,452 @@
+#include "storage/tuple.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace pcsql {
+
+namespace {
+
+constexpr std::size_t HEADER = 1 + sizeof(std::uint16_t); // tag + column count
+
+bool is_var(DataType t) { return t == DataType::VARCHAR || t == DataType::UNKNOWN; }
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+bool null_text(DataType t, std::string_view v) { return iequals(v, "null") || (v.empty() && !is_var(t)); }
+
+std::optional<std::int64_t> parse_int(std::string_view v) {
+    if (!v.empty() && v.front() == '+') v.remove_prefix(1);
+    std::int64_t out = 0;
+    auto [p, ec] = std::from_chars(v.data(), v.data() + v.size(), out);
+    if (ec != std::errc() || p != v.data() + v.size() || v.empty()) return std::nullopt;
+    return out;
+}
+
+std::optional<double> parse_double(std::string_view v) {
+    if (!v.empty() && v.front() == '+') v.remove_prefix(1);
+    double out = 0;
+    auto [p, ec] = std::from_chars(v.data(), v.data() + v.size(), out);
+    if (ec != std::errc() || p != v.data() + v.size() || v.empty()) return std::nullopt;
+    return out;
+}
+
+std::optional<bool> parse_bool(std::string_view v) {
+    if (iequals(v, "true") || v == "1" || iequals(v, "yes") || iequals(v, "y")) return true;
+    if (iequals(v, "false") || v == "0" || iequals(v, "no") || iequals(v, "n")) return false;
+    return std::nullopt;
+}
+
+std::string format_double(double d) {
+    char buf[64];
+    auto [p, ec] = std::to_chars(buf, buf + sizeof(buf), d); // 最短可往返表示
+    return ec == std::errc() ? std::string(buf, p) : std::to_string(d);
+}
+
+template <typename T>
+T load(const char* p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <typename T>
+void store(char* p, T v) { std::memcpy(p, &v, sizeof(T)); }
+
+// days since 1970-01-01 of a proleptic Gregorian date, and back (H. Hinnant's algorithms)
+std::int64_t days_from_civil(std::int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+void civil_from_days(std::int64_t z, std::int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+template <typename T>
+int three_way(const T& a, const T& b) { return a < b ? -1 : (b < a ? 1 : 0); }
+
+} // namespace
+
+// ---------------- Layout ----------------
+
+TupleLayout::TupleLayout(std::vector<DataType> types) : types_(std::move(types)) {
+    std::size_t off = HEADER + (types_.size() + 7) / 8;
+    offsets_.reserve(types_.size());
+    for (auto t : types_) {
+        offsets_.push_back(off);
+        off += slot_width(t);
+    }
+    fixed_size_ = off;
+}
+
+TupleLayout::TupleLayout(const TableSchema& schema) : TupleLayout([&] {
+    std::vector<DataType> types;
+    types.reserve(schema.columns.size());
+    for (const auto& c : schema.columns) types.push_back(c.type);
+    return types;
+}()) {}
+
+std::size_t TupleLayout::slot_width(DataType type) {
+    switch (type) {
+        case DataType::INT:
+        case DataType::TIMESTAMP: return sizeof(std::int64_t);
+        case DataType::DOUBLE: return sizeof(double);
+        case DataType::BOOLEAN: return 1;
+        default: return 2 * sizeof(std::uint16_t); // VARCHAR/UNKNOWN: offset + length
+    }
+}
+
+// ---------------- Encoding ----------------
+
+namespace {
+
+// external: columns to store as a (zeroed) OverflowRef, patched by the caller; may be null
+std::string encode_impl(const TupleLayout& layout, const std::vector<std::string>& values,
+                        const std::vector<bool>* external) {
+    const std::size_t n = layout.columns();
+    if (values.size() > n) throw std::invalid_argument("too many values for the table's columns");
+    std::string out(layout.fixed_size(), '\0');
+    out[0] = static_cast<char>(TUPLE_TAG);
+    store<std::uint16_t>(&out[1], static_cast<std::uint16_t>(n));
+    for (std::size_t i = 0; i < n; ++i) {
+        DataType t = layout.type(i);
+        if (i >= values.size() || null_text(t, values[i])) {
+            out[HEADER + i / 8] = static_cast<char>(out[HEADER + i / 8] | (1u << (i % 8)));
+            continue;
+        }
+        const std::string& v = values[i];
+        char* slot = &out[layout.offset(i)];
+        auto bad = [&](const char* type) {
+            return std::invalid_argument("invalid " + std::string(type) + " value '" + v + "' for column " + std::to_string(i + 1));
+        };
+        switch (t) {
+            case DataType::INT: {
+                auto x = parse_int(v);
+                if (!x) throw bad("INT");
+                store<std::int64_t>(slot, *x);
+                break;
+            }
+            case DataType::TIMESTAMP: {
+                auto x = parse_timestamp(v);
+                if (!x) throw bad("TIMESTAMP");
+                store<std::int64_t>(slot, *x);
+                break;
+            }
+            case DataType::DOUBLE: {
+                auto x = parse_double(v);
+                if (!x) throw bad("DOUBLE");
+                store<double>(slot, *x);
+                break;
+            }
+            case DataType::BOOLEAN: {
+                auto x = parse_bool(v);
+                if (!x) throw bad("BOOLEAN");
+                *slot = *x ? 1 : 0;
+                break;
+            }
+            default: {
+                std::size_t off = out.size();
+                bool ext = external && (*external)[i];
+                std::size_t size = ext ? sizeof(OverflowRef) : v.size();
+                if (!ext && size >= TUPLE_EXTERNAL) throw std::invalid_argument("value too large for column " + std::to_string(i + 1));
+                if (off + size > UINT16_MAX) throw std::invalid_argument("row too large");
+                // slot 指针在 append 之前写，避免 out 重新分配后失效
+                store<std::uint16_t>(slot, static_cast<std::uint16_t>(off));
+                store<std::uint16_t>(slot + sizeof(std::uint16_t), static_cast<std::uint16_t>(ext ? (size | TUPLE_EXTERNAL) : size));
+                if (ext) out.append(size, '\0'); else out.append(v);
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+std::string encode_tuple(const TupleLayout& layout, const std::vector<std::string>& values) {
+    return encode_impl(layout, values, nullptr);
+}
+
+std::string encode_tuple(const TupleLayout& layout, const std::vector<std::string>& values,
+                         OverflowStore& overflow, std::int32_t table_id, std::size_t threshold) {
+    return encode_tuple(layout, values, {}, overflow, table_id, threshold);
+}
+
+std::string encode_tuple(const TupleLayout& layout, const std::vector<std::string>& values,
+                         const std::vector<std::optional<OverflowRef>>& kept,
+                         OverflowStore& overflow, std::int32_t table_id, std::size_t threshold) {
+    auto keeps = [&](std::size_t i) { return i < kept.size() && kept[i].has_value(); };
+    // 按编码后的大小挑选：最长的 VARCHAR 先移出，直到行不超过阈值；沿用的引用只占 OverflowRef 大小
+    std::size_t size = layout.fixed_size();
+    std::vector<std::size_t> candidates;
+    std::vector<bool> external(layout.columns(), false);
+    bool any = false;
+    for (std::size_t i = 0; i < layout.columns() && i < values.size(); ++i) {
+        if (keeps(i)) {
+            external[i] = any = true;
+            size += sizeof(OverflowRef);
+            continue;
+        }
+        if (!is_var(layout.type(i)) || null_text(layout.type(i), values[i])) continue;
+        size += values[i].size();
+        if (values[i].size() > TUPLE_MIN_EXTERNAL) candidates.push_back(i);
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [&](std::size_t a, std::size_t b) { return values[a].size() > values[b].size(); });
+    for (std::size_t i : candidates) {
+        if (size <= threshold) break;
+        external[i] = any = true;
+        size -= values[i].size() - sizeof(OverflowRef);
+    }
+    std::string out = encode_impl(layout, values, any ? &external : nullptr); // 先完成校验，再写溢出页
+    auto patch = [&](std::size_t i, const OverflowRef& ref) {
+        std::uint16_t off = load<std::uint16_t>(&out[layout.offset(i)]);
+        std::memcpy(&out[off], &ref, sizeof(ref));
+    };
+    std::vector<OverflowRef> written;
+    try {
+        for (std::size_t i = 0; i < layout.columns(); ++i) {
+            if (!external[i]) continue;
+            if (keeps(i)) { patch(i, *kept[i]); continue; }
+            OverflowRef ref = overflow.write(table_id, values[i]);
+            written.push_back(ref);
+            patch(i, ref);
+        }
+    } catch (...) {
+        for (const auto& ref : written) overflow.free(ref);
+        throw;
+    }
+    return out;
+}
+
+// ---------------- View ----------------
+
+TupleView::TupleView(const TupleLayout& layout, std::string_view bytes, const OverflowStore* overflow)
+    : layout_(&layout), bytes_(bytes),
+      legacy_(bytes.size() < HEADER || static_cast<std::uint8_t>(bytes[0]) != TUPLE_TAG), overflow_(overflow) {}
+
+std::string_view TupleView::legacy_field(std::size_t i) const {
+    std::size_t start = 0;
+    for (std::size_t k = 0; k < i; ++k) {
+        std::size_t bar = bytes_.find('|', start);
+        if (bar == std::string_view::npos) return std::string_view();
+        start = bar + 1;
+    }
+    std::size_t end = bytes_.find('|', start);
+    return bytes_.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+}
+
+bool TupleView::is_null(std::size_t i) const {
+    if (i >= layout_->columns()) return true;
+    if (legacy_) return null_text(layout_->type(i), legacy_field(i));
+    std::size_t stored = load<std::uint16_t>(bytes_.data() + 1);
+    // 列数不符或截断的行：缺少的列按 NULL 处理
+    if (i >= stored || bytes_.size() < layout_->fixed_size()) return true;
+    return (static_cast<unsigned char>(bytes_[HEADER + i / 8]) >> (i % 8)) & 1u;
+}
+
+std::int64_t TupleView::get_int(std::size_t i) const {
+    if (is_null(i)) return 0;
+    if (legacy_) {
+        auto f = legacy_field(i);
+        auto x = layout_->type(i) == DataType::TIMESTAMP ? parse_timestamp(f) : parse_int(f);
+        return x.value_or(0);
+    }
+    return load<std::int64_t>(bytes_.data() + layout_->offset(i));
+}
+
+double TupleView::get_double(std::size_t i) const {
+    if (is_null(i)) return 0;
+    if (legacy_) return parse_double(legacy_field(i)).value_or(0);
+    return load<double>(bytes_.data() + layout_->offset(i));
+}
+
+bool TupleView::get_bool(std::size_t i) const {
+    if (is_null(i)) return false;
+    if (legacy_) return parse_bool(legacy_field(i)).value_or(false);
+    return bytes_[layout_->offset(i)] != 0;
+}
+
+std::string_view TupleView::get_varchar(std::size_t i) const {
+    if (is_null(i)) return std::string_view();
+    if (legacy_) return legacy_field(i);
+    const char* slot = bytes_.data() + layout_->offset(i);
+    std::size_t off = load<std::uint16_t>(slot);
+    std::size_t len = load<std::uint16_t>(slot + sizeof(std::uint16_t));
+    if (len & TUPLE_EXTERNAL) {
+        auto it = fetched_.find(i);
+        if (it != fetched_.end()) return it->second;
+        auto ref = external_ref(i);
+        if (!ref) return std::string_view();
+        if (!overflow_) throw std::logic_error("column " + std::to_string(i + 1) + " is stored out of line: TupleView needs the OverflowStore");
+        return fetched_.emplace(i, overflow_->read(*ref)).first->second;
+    }
+    if (off + len > bytes_.size()) return std::string_view();
+    return bytes_.substr(off, len);
+}
+
+std::optional<OverflowRef> TupleView::external_ref(std::size_t i) const {
+    if (legacy_ || is_null(i) || !is_var(layout_->type(i))) return std::nullopt;
+    const char* slot = bytes_.data() + layout_->offset(i);
+    std::size_t off = load<std::uint16_t>(slot);
+    std::size_t len = load<std::uint16_t>(slot + sizeof(std::uint16_t));
+    if (!(len & TUPLE_EXTERNAL) || off + sizeof(OverflowRef) > bytes_.size()) return std::nullopt;
+    return load<OverflowRef>(bytes_.data() + off);
+}
+
+std::string TupleView::text(std::size_t i) const {
+    if (legacy_) return std::string(legacy_field(i));
+    if (is_null(i)) return "NULL";
+    switch (layout_->type(i)) {
+        case DataType::INT: return std::to_string(get_int(i));
+        case DataType::TIMESTAMP: return format_timestamp(get_int(i));
+        case DataType::DOUBLE: return format_double(get_double(i));
+        case DataType::BOOLEAN: return get_bool(i) ? "true" : "false";
+        default: return std::string(get_varchar(i));
+    }
+}
+
+std::vector<std::string> TupleView::texts() const {
+    std::vector<std::string> out;
+    out.reserve(layout_->columns());
+    for (std::size_t i = 0; i < layout_->columns(); ++i) out.push_back(text(i));
+    return out;
+}
+
+std::string TupleView::to_text() const {
+    if (legacy_) return std::string(bytes_);
+    std::string out;
+    for (std::size_t i = 0; i < layout_->columns(); ++i) {
+        if (i) out += '|';
+        out += text(i);
+    }
+    return out;
+}
+
+// ---------------- Predicate ----------------
+
+std::optional<TuplePredicate> TuplePredicate::make(const TupleLayout& layout, std::size_t column,
+                                                   const std::string& op, std::string literal) {
+    if (column >= layout.columns()) return std::nullopt;
+    TuplePredicate p;
+    if (op == "=") p.op_ = Op::EQ;
+    else if (op == "!=") p.op_ = Op::NE;
+    else if (op == "<") p.op_ = Op::LT;
+    else if (op == ">") p.op_ = Op::GT;
+    else if (op == "<=") p.op_ = Op::LE;
+    else if (op == ">=") p.op_ = Op::GE;
+    else return std::nullopt;
+    p.column_ = column;
+    p.type_ = layout.type(column);
+    if (literal.size() >= 2 && ((literal.front() == '\'' && literal.back() == '\'') || (literal.front() == '"' && literal.back() == '"'))) {
+        literal = literal.substr(1, literal.size() - 2);
+    }
+    switch (p.type_) {
+        case DataType::INT: {
+            auto x = parse_int(literal);
+            if (x) p.int_ = *x; else p.text_mode_ = true;
+            break;
+        }
+        case DataType::TIMESTAMP: {
+            auto x = parse_timestamp(literal);
+            if (x) p.int_ = *x; else p.text_mode_ = true;
+            break;
+        }
+        case DataType::DOUBLE: {
+            auto x = parse_double(literal);
+            if (x) p.double_ = *x; else p.text_mode_ = true;
+            break;
+        }
+        case DataType::BOOLEAN: {
+            auto x = parse_bool(literal);
+            if (x) p.bool_ = *x; else p.text_mode_ = true;
+            break;
+        }
+        default: break;
+    }
+    p.text_ = std::move(literal);
+    return p;
+}
+
+bool TuplePredicate::holds(int c) const {
+    switch (op_) {
+        case Op::EQ: return c == 0;
+        case Op::NE: return c != 0;
+        case Op::LT: return c < 0;
+        case Op::GT: return c > 0;
+        case Op::LE: return c <= 0;
+        case Op::GE: return c >= 0;
+    }
+    return false;
+}
+
+bool TuplePredicate::matches(const TupleView& row) const {
+    if (row.is_null(column_)) return false;
+    if (text_mode_) return holds(three_way(row.text(column_), text_));
+    switch (type_) {
+        case DataType::INT:
+        case DataType::TIMESTAMP: return holds(three_way(row.get_int(column_), int_));
+        case DataType::DOUBLE: return holds(three_way(row.get_double(column_), double_));
+        case DataType::BOOLEAN: return holds(three_way(row.get_bool(column_), bool_));
+        default: return holds(three_way(row.get_varchar(column_), std::string_view(text_)));
+    }
+}
+
+// ---------------- TIMESTAMP ----------------
+
+std::optional<std::int64_t> parse_timestamp(std::string_view text) {
+    auto num = [&](std::size_t pos, std::size_t len, unsigned& out) {
+        if (pos + len > text.size()) return false;
+        auto [p, ec] = std::from_chars(text.data() + pos, text.data() + pos + len, out);
+        return ec == std::errc() && p == text.data() + pos + len;
+    };
+    unsigned y = 0, mo = 0, d = 0, h = 0, mi = 0, s = 0;
+    if (!num(0, 4, y) || text.size() < 10 || text[4] != '-' || !num(5, 2, mo) || text[7] != '-' || !num(8, 2, d)) {
+        return std::nullopt;
+    }
+    if (text.size() != 10) {
+        if (text.size() != 19 || (text[10] != ' ' && text[10] != 'T') || !num(11, 2, h) || text[13] != ':' ||
+            !num(14, 2, mi) || text[16] != ':' || !num(17, 2, s)) {
+            return std::nullopt;
+        }
+    }
+    if (mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || s > 59) return std::nullopt;
+    return days_from_civil(y, mo, d) * 86400 + h * 3600 + mi * 60 + s;
+}
+
+std::string format_timestamp(std::int64_t seconds) {
+    std::int64_t days = seconds >= 0 ? seconds / 86400 : (seconds - 86399) / 86400;
+    std::int64_t rem = seconds - days * 86400;
+    std::int64_t y;
+    unsigned m, d;
+    civil_from_days(days, y, m, d);
+    char buf[64]; // 年份是 64 位，极端值也放得下
+    std::snprintf(buf, sizeof(buf), "%04lld-%02u-%02u %02lld:%02lld:%02lld", static_cast<long long>(y), m, d,
+                  static_cast<long long>(rem / 3600), static_cast<long long>(rem / 60 % 60), static_cast<long long>(rem % 60));
+    return buf;
+}
+
+} // namespace pcsql
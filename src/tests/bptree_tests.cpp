@@ -62,6 +62,22 @@ int main() {
         assert(res[i].first == 50 + i);
     }
 
+    // erase: entries leave the leaf only; emptied leaves are skipped by range and reusable by insert
+    {
+        BPlusTree big(disk, buf);
+        big.create();
+        for (int i = 0; i < 3000; ++i) assert(big.insert(i, RID{static_cast<std::uint32_t>(i), 0}));
+        for (int i = 300; i < 2700; ++i) assert(big.erase(i));
+        assert(!big.erase(1000) && !big.erase(5000));
+        RID got;
+        assert(!big.search(1500, got) && big.search(2999, got) && got.page_id == 2999);
+        auto all = big.range(0, 2999);
+        assert(all.size() == 600 && all[299].first == 299 && all[300].first == 2700);
+        assert(big.insert(1500, RID{1500, 1}) && big.search(1500, got) && got.slot_id == 1);
+        assert(big.range(1000, 2000).size() == 1);
+        assert(idx.erase(42) && !idx.search(42, got) && idx.insert(42, rids[42]));
+    }
+
     // ---- String-key B+Tree tests ----
     {
         // Insert 120 string keys: key0000 .. key0119
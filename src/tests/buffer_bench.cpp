@@ -0,0 +1,59 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "storage/buffer_manager.hpp"
+#include "storage/disk_manager.hpp"
+
+using namespace pcsql;
+
+// Buffer pool replacement-policy micro benchmark (not part of ctest):
+//   hot  : working set fits in the pool, every access is a hit -> cost of the hit path
+//   skew : 80/20 access over a set 4x larger than the pool -> hit ratio and miss cost
+// Usage: buffer_bench [ops]
+static double run(BufferManager& buf, const std::vector<std::uint32_t>& trace) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto pid : trace) {
+        buf.get_page(pid);
+        buf.unpin_page(pid, false);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(trace.size());
+}
+
+int main(int argc, char** argv) {
+    const std::size_t ops = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    const std::size_t frames = 256;
+    const std::string dir = "buffer_bench_data";
+    std::filesystem::remove_all(dir);
+    DiskManager disk(dir);
+    std::vector<std::uint32_t> pages;
+    for (std::size_t i = 0; i < frames * 4; ++i) pages.push_back(disk.allocate_page());
+
+    std::mt19937 rng(42);
+    std::vector<std::uint32_t> hot, skew;
+    std::uniform_int_distribution<std::size_t> in_pool(0, frames / 2 - 1);
+    std::uniform_int_distribution<std::size_t> hot20(0, pages.size() / 5 - 1), all(0, pages.size() - 1);
+    std::uniform_int_distribution<int> pct(0, 99);
+    for (std::size_t i = 0; i < ops; ++i) {
+        hot.push_back(pages[in_pool(rng)]);
+        skew.push_back(pages[pct(rng) < 80 ? hot20(rng) : all(rng)]);
+    }
+
+    std::printf("%-6s %14s %14s %10s\n", "policy", "hot ns/op", "skew ns/op", "skew hit%");
+    for (Policy p : {Policy::LRU, Policy::FIFO, Policy::CLOCK, Policy::TWO_Q}) {
+        BufferManager a(disk, frames, p, false);
+        run(a, hot); // warm up
+        double hot_ns = run(a, hot);
+        BufferManager b(disk, frames, p, false);
+        double skew_ns = run(b, skew);
+        auto st = b.stats();
+        double hit = 100.0 * static_cast<double>(st.hits) / static_cast<double>(st.hits + st.misses);
+        std::printf("%-6s %14.1f %14.1f %10.2f\n", to_string(p), hot_ns, skew_ns, hit);
+    }
+    std::filesystem::remove_all(dir);
+    return 0;
+}
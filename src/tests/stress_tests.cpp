@@ -1,8 +1,13 @@
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
 #include <random>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -105,6 +110,131 @@ int main() {
     }
 
     eng.flush_all();
+
+    // 并发缓冲池：多线程对少量帧反复 pin/写/unpin（伴随大量驱逐与写回，后台写线程同时运行），计数不丢失
+    for (Policy pol : {Policy::LRU, Policy::FIFO, Policy::CLOCK, Policy::TWO_Q}) {
+        const std::string dir = base + "/concurrent";
+        clean_dir(dir);
+        DiskManager disk(dir);
+        BufferManager buf(disk, /*frames*/ 8, pol, false);
+        const int npages = 32, nthreads = 4, iters = 2000;
+        std::vector<std::uint32_t> pids;
+        for (int i = 0; i < npages; ++i) pids.push_back(disk.allocate_page());
+        WriterOptions wo;
+        wo.interval = std::chrono::milliseconds(1);
+        buf.start_background_writer(wo);
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < nthreads; ++t) {
+            workers.emplace_back([&, t] {
+                std::mt19937 trng(1000 + t);
+                std::uniform_int_distribution<int> pick(0, npages - 1);
+                for (int i = 0; i < iters; ++i) {
+                    std::uint32_t pid = pids[pick(trng)];
+                    Page& p = buf.get_page(pid);
+                    {
+                        std::unique_lock<std::shared_mutex> latch(p.latch);
+                        std::uint32_t v;
+                        std::memcpy(&v, p.data.data(), sizeof(v));
+                        ++v;
+                        std::memcpy(p.data.data(), &v, sizeof(v));
+                    }
+                    buf.unpin_page(pid, true);
+                    if (i % 500 == 0) buf.flush_all();
+                }
+            });
+        }
+        // 并发的顺序扫描（私有环 + 预读）
+        workers.emplace_back([&] {
+            for (int r = 0; r < 20; ++r) {
+                ScanContext ctx(buf, pids, 2, 4);
+                for (auto pid : pids) ReadPageGuard g(buf, pid, ctx);
+            }
+        });
+        // 并发的在线扩缩容（8 <-> 24 帧）；收缩遇到长时间被 pin 的页会超时，下一次收缩继续排空
+        std::atomic<bool> done{false};
+        std::thread resizer([&] {
+            for (int r = 0; !done; ++r) {
+                try { buf.resize(r % 2 ? 8 : 24, std::chrono::milliseconds(5)); } catch (const std::runtime_error&) {}
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            buf.resize(8);
+        });
+        for (auto& w : workers) w.join();
+        done = true;
+        resizer.join();
+        buf.stop_background_writer();
+        buf.flush_all();
+
+        // 静止后经扫描路径读到的计数与磁盘一致
+        std::uint64_t scanned = 0;
+        {
+            ScanContext ctx(buf, pids, 2, 4);
+            for (auto pid : pids) {
+                ReadPageGuard g(buf, pid, ctx);
+                std::uint32_t v;
+                std::memcpy(&v, g.data(), sizeof(v));
+                scanned += v;
+            }
+        }
+        assert(scanned == static_cast<std::uint64_t>(nthreads) * iters);
+
+        std::uint64_t total = 0;
+        std::vector<char> raw(disk.page_size());
+        for (auto pid : pids) {
+            disk.read_page(pid, raw.data());
+            std::uint32_t v;
+            std::memcpy(&v, raw.data(), sizeof(v));
+            total += v;
+        }
+        assert(total == static_cast<std::uint64_t>(nthreads) * iters);
+        auto st = buf.stats();
+        assert(st.hits + st.misses == static_cast<std::size_t>(nthreads) * iters + 21 * npages);
+        assert(st.evictions > 0);
+    }
+
+    // 批量装载吞吐：同样的带索引行，逐行 insert_record + update_indexes_on_insert 对比 insert_batch
+    {
+        const std::string dir = base + "/bulk";
+        clean_dir(dir);
+        StorageEngine e(dir, 64, Policy::LRU, false);
+        std::vector<ColumnMetadata> cols(2);
+        cols[0].name = "id"; cols[0].type = DataType::INT;
+        cols[1].name = "v"; cols[1].type = DataType::VARCHAR; cols[1].length = 64;
+        auto t1 = e.create_table("row_load", cols);
+        auto t2 = e.create_table("bulk_load", cols);
+        assert(e.create_index("row_id", "row_load", "id") && e.create_index("bulk_id", "bulk_load", "id"));
+        const int n = 4000;
+        std::vector<std::string> rows;
+        rows.reserve(n);
+        TupleLayout layout(e.get_table_schema("row_load"));
+        for (int i = 0; i < n; ++i) rows.push_back(encode_tuple(layout, {std::to_string((i * 7919) % n), gen_string(rng, 48)}));
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (const auto& row : rows) {
+            RID r = e.insert_record(t1, row);
+            e.update_indexes_on_insert(t1, row, r);
+        }
+        auto per_row = std::chrono::steady_clock::now() - t0;
+        t0 = std::chrono::steady_clock::now();
+        auto rids = e.insert_batch(t2, rows);
+        auto batch = std::chrono::steady_clock::now() - t0;
+
+        assert(rids.size() == rows.size());
+        assert(e.scan_table(t2).size() == static_cast<std::size_t>(n));
+        for (int k = 0; k < n; k += 101) {
+            assert(e.index_select_eq_int(t1, 0, k).size() == 1);
+            assert(e.index_select_eq_int(t2, 0, k).size() == 1);
+        }
+        double speedup = std::chrono::duration<double>(per_row).count() /
+                         std::max(1e-9, std::chrono::duration<double>(batch).count());
+        std::cout << "bulk load: per-row " << std::chrono::duration<double, std::milli>(per_row).count()
+                  << " ms, batch " << std::chrono::duration<double, std::milli>(batch).count()
+                  << " ms, speedup " << speedup << "x\n";
+        assert(speedup >= 4.0); // 优化构建约 40 倍；未优化构建约 12 倍，这里留出机器负载的余量
+        e.flush_all();
+    }
+
     std::cout << "All stress tests passed.\n";
     return 0;
 }
\ No newline at end of file